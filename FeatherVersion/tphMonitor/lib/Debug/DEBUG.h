@@ -34,4 +34,46 @@ void setupSerialDebug() {
 
 
 #endif // DEBUG
+
+//------------------------------------------------------------------------------
+// Heap allocations: call DEBUGHEAPSETTLED() at the end of setup(), and any
+// operator new after it stops the program, naming the size.  The host
+// simulation counts in its core stand-in; on the board it's DEBUG only.
+#if defined(HOST_SIM)
+#include <HostSim.h>
+#define DEBUGHEAPSETTLED() sim::heapSettled()
+#elif defined(DEBUG)
+#define DEBUGHEAPSETTLED() debugHeapSettled()
+
+#include <stdlib.h>
+
+static uint32_t debugHeapAllocations = 0;
+static bool debugHeapIsSettled = false;
+
+void debugHeapSettled() {
+    debugHeapIsSettled = true;
+    Serial.print("heap allocations in setup(): ");
+    Serial.println(debugHeapAllocations);
+}
+
+static void *debugHeapAllocate(size_t size) {
+    debugHeapAllocations++;
+    if (debugHeapIsSettled) {
+        Serial.print("heap allocation after setup(): ");
+        Serial.print(size);
+        Serial.println(" bytes");
+        while (true) ;
+    }
+    return malloc(size);
+}
+
+// replace the core's new.cpp, all four so none of it gets linked
+void *operator new(size_t size) { return debugHeapAllocate(size); }
+void *operator new[](size_t size) { return debugHeapAllocate(size); }
+void operator delete(void *ptr) { free(ptr); }
+void operator delete[](void *ptr) { free(ptr); }
+#else
+#define DEBUGHEAPSETTLED()
+#endif
+
 #endif // DEBUG_H
@@ -0,0 +1,294 @@
+// EPD_FRAMES.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Compressed frame store in EPD_FLASH, see EPD_FRAMES.h
+
+#include <string.h>
+#include "EPD_FRAMES.h"
+
+// each sector starts with a header: SECTOR_MAGIC, then the sector's sequence
+// number, one more than the sector written before it
+#define SECTOR_MAGIC 0x53465045UL // "EPFS"
+#define SECTOR_HEADER_SIZE 8
+
+// then records: type, 0, payload length (little endian), then the payload.
+// The header is programmed after the payload, so a record that was never
+// finished has none
+#define RECORD_HEADER_SIZE 4
+
+// a key record of the largest frame, coded at worst, fills a sector
+static_assert(EPD_FRAMES_MAX_FRAME_SIZE + (EPD_FRAMES_MAX_FRAME_SIZE + 127) / 128
+	      <= EPD_FLASH_SECTOR_SIZE - SECTOR_HEADER_SIZE - RECORD_HEADER_SIZE,
+	      "EPD_FRAMES_MAX_FRAME_SIZE must leave room for the headers");
+enum {
+	RECORD_KEY = 'K',
+	RECORD_DELTA = 'D'
+};
+
+// the default store
+EPD_FRAMES_Class EPD_FRAMES;
+
+void EPD_FRAMES_reader(void *buffer, uint32_t address, uint16_t length) {
+	EPD_FRAMES.read(buffer, address, length);
+}
+
+EPD_FRAMES_Class::EPD_FRAMES_Class(void) :
+	first(0),
+	sectors(0),
+	frame_size(0),
+	sector(0),
+	sequence(0),
+	head(0),
+	chain_length(0),
+	read_offset(0),
+	last_record_size(0) {
+}
+
+
+void EPD_FRAMES_Class::begin(uint16_t first_sector, uint16_t sector_count, uint16_t frame_size) {
+	this->first = (uint32_t)first_sector << EPD_FLASH_SECTOR_SHIFT;
+	this->sectors = sector_count;
+	this->frame_size = frame_size;
+	this->chain_length = 0;
+	this->read_offset = 0;
+
+	// a key record wouldn't fit in a sector
+	if (frame_size > EPD_FRAMES_MAX_FRAME_SIZE) {
+		this->sectors = 0;
+		return;
+	}
+
+	// the newest sector, from the sector headers alone
+	bool found = false;
+	this->sector = sector_count - 1;
+	this->sequence = 0;
+	for (uint16_t s = 0; s < sector_count; ++s) {
+		uint32_t header[2];
+		EPD_FLASH.read(header, this->sector_address(s), sizeof(header));
+		if (SECTOR_MAGIC == header[0] && 0xffffffff != header[1] &&
+		    (!found || header[1] > this->sequence)) {
+			found = true;
+			this->sector = s;
+			this->sequence = header[1];
+		}
+	}
+
+	// whatever it held is of no use now, carry on after it
+	this->next_sector();
+}
+
+
+void EPD_FRAMES_Class::write(const uint8_t *image) {
+	if (0 == this->sectors) {
+		return; // not begun, or the frame is too large
+	}
+	bool key = 0 == this->chain_length || EPD_FRAMES_CHAIN == this->chain_length;
+	uint16_t size = this->encode(image, key, NULL);
+
+	const uint32_t end = this->sector_address(this->sector) + EPD_FLASH_SECTOR_SIZE;
+	if (this->head + RECORD_HEADER_SIZE + size > end) {
+		// a chain stays in its sector, so the next one can be erased
+		if (!key) {
+			key = true;
+			size = this->encode(image, key, NULL);
+		}
+		if (this->head + RECORD_HEADER_SIZE + size > end) {
+			this->next_sector();
+		}
+	}
+
+	uint32_t payload = this->head + RECORD_HEADER_SIZE;
+	uint32_t address = payload;
+	this->encode(image, key, &address);
+	const uint8_t header[RECORD_HEADER_SIZE] = {
+		(uint8_t)(key ? RECORD_KEY : RECORD_DELTA), 0, (uint8_t)size, (uint8_t)(size >> 8)
+	};
+	this->program(this->head, header, sizeof(header));
+
+	if (key) {
+		this->chain_length = 0;
+	}
+	this->chain[this->chain_length++] = payload;
+	this->head = payload + size;
+	this->last_record_size = RECORD_HEADER_SIZE + size;
+	this->restart();
+}
+
+
+void EPD_FRAMES_Class::read(void *buffer, uint32_t offset, uint16_t length) {
+	uint8_t *p = (uint8_t *)buffer;
+	if (0 == this->chain_length) {
+		memset(p, 0, length);
+		return;
+	}
+	if (offset < this->read_offset) {
+		this->restart();
+	}
+	for (; this->read_offset < offset + length; ++this->read_offset) {
+		uint8_t b = 0;
+		for (uint8_t i = 0; i < this->chain_length; ++i) {
+			b ^= this->decode(this->decoders[i]);
+		}
+		if (this->read_offset >= offset) {
+			*p++ = b;
+		}
+	}
+}
+
+
+// internal functions
+// ==================
+
+uint32_t EPD_FRAMES_Class::sector_address(uint16_t ring_sector) const {
+	return this->first + ((uint32_t)ring_sector << EPD_FLASH_SECTOR_SHIFT);
+}
+
+
+// erase the next sector in the ring and start writing there
+void EPD_FRAMES_Class::next_sector(void) {
+	this->sector = (this->sector + 1) % this->sectors;
+	++this->sequence;
+
+	const uint32_t address = this->sector_address(this->sector);
+	EPD_FLASH.write_enable();
+	EPD_FLASH.sector_erase(address);
+	const uint32_t header[2] = { SECTOR_MAGIC, this->sequence };
+	this->program(address, (const uint8_t *)header, sizeof(header));
+	this->head = address + SECTOR_HEADER_SIZE;
+}
+
+
+// write to erased flash, a page program for each EPD_FLASH_PAGE_SIZE page
+// touched
+void EPD_FRAMES_Class::program(uint32_t address, const uint8_t *data, uint16_t length) {
+	while (0 != length) {
+		uint16_t n = EPD_FLASH_PAGE_SIZE - address % EPD_FLASH_PAGE_SIZE;
+		if (n > length) {
+			n = length;
+		}
+		EPD_FLASH.write_enable();
+		EPD_FLASH.write(address, data, n);
+		address += n;
+		data += n;
+		length -= n;
+	}
+}
+
+
+// code image, XORed with the current frame (or white for a key), as PackBits:
+// a control byte n < 128 is followed by n + 1 literal bytes, 128 + n by one
+// byte repeated n + 1 times.  Returns the size, and when address isn't NULL
+// writes it there, leaving address after it
+uint16_t EPD_FRAMES_Class::encode(const uint8_t *image, bool key, uint32_t *address) {
+	uint16_t size = 0;
+	uint8_t page[EPD_FLASH_PAGE_SIZE];
+	uint16_t pending = 0;
+	auto put = [&](uint8_t b) {
+		++size;
+		if (NULL == address) {
+			return;
+		}
+		page[pending++] = b;
+		if (0 == (*address + pending) % EPD_FLASH_PAGE_SIZE) {
+			this->program(*address, page, pending);
+			*address += pending;
+			pending = 0;
+		}
+	};
+
+	uint8_t literal[128];
+	uint8_t literals = 0;
+	auto put_literals = [&]() {
+		if (0 == literals) {
+			return;
+		}
+		put(literals - 1);
+		for (uint8_t i = 0; i < literals; ++i) {
+			put(literal[i]);
+		}
+		literals = 0;
+	};
+
+	uint8_t value = 0;
+	uint8_t run = 0;
+	auto end_run = [&]() {
+		if (run >= 3) {
+			put_literals();
+			put(0x80 | (run - 1));
+			put(value);
+			run = 0;
+		}
+		for (; 0 != run; --run) {
+			// shorter runs cost no more as literals
+			literal[literals++] = value;
+			if (sizeof(literal) == literals) {
+				put_literals();
+			}
+		}
+	};
+
+	uint8_t old[32];
+	memset(old, 0, sizeof(old));
+	for (uint16_t offset = 0; offset < this->frame_size; offset += sizeof(old)) {
+		uint16_t length = this->frame_size - offset;
+		if (length > sizeof(old)) {
+			length = sizeof(old);
+		}
+		if (!key) {
+			this->read(old, offset, length);
+		}
+		for (uint16_t i = 0; i < length; ++i) {
+			uint8_t b = image[offset + i] ^ old[i];
+			if (0 != run && (b != value || 128 == run)) {
+				end_run();
+			}
+			value = b;
+			++run;
+		}
+	}
+	end_run();
+	put_literals();
+
+	if (NULL != address && 0 != pending) {
+		this->program(*address, page, pending);
+		*address += pending;
+	}
+	return size;
+}
+
+
+// decode the current frame from its first byte again
+void EPD_FRAMES_Class::restart(void) {
+	for (uint8_t i = 0; i < this->chain_length; ++i) {
+		Decoder &d = this->decoders[i];
+		d.address = this->chain[i];
+		d.used = sizeof(d.buffer);
+		d.count = 0;
+	}
+	this->read_offset = 0;
+}
+
+
+uint8_t EPD_FRAMES_Class::fetch(Decoder &d) {
+	if (sizeof(d.buffer) == d.used) {
+		EPD_FLASH.read(d.buffer, d.address, sizeof(d.buffer));
+		d.address += sizeof(d.buffer);
+		d.used = 0;
+	}
+	return d.buffer[d.used++];
+}
+
+
+uint8_t EPD_FRAMES_Class::decode(Decoder &d) {
+	if (0 == d.count) {
+		uint8_t control = this->fetch(d);
+		d.run = 0 != (control & 0x80);
+		d.count = (control & 0x7f) + 1;
+		if (d.run) {
+			d.value = this->fetch(d);
+		}
+	}
+	--d.count;
+	return d.run ? d.value : this->fetch(d);
+}
@@ -0,0 +1,106 @@
+// EPD_FRAMES.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Compressed frame store in EPD_FLASH
+//
+// Frames are appended to a ring of sectors as records, each the PackBits
+// run-length coding of the frame XORed with the one before it (a delta), or
+// with white (a key).  A mostly white frame, or one that differs from the
+// last in a few lines, codes to tens or hundreds of bytes instead of a whole
+// frame, so a sector is only erased every few tens of frames, and the
+// erases go round the ring.
+//
+// A chain of records -- a key and up to EPD_FRAMES_CHAIN - 1 deltas -- never
+// crosses into another sector, so a sector can be erased as the head moves
+// into it whatever it held.  begin() carries on in the sector after the
+// newest one, so resets don't wear the first sector either.
+//
+// read() decodes the current frame as it goes, one decoder per record in the
+// chain, and EPD_FRAMES_reader() hands it to EPD_Class::frame_cb().
+
+#if !defined(EPD_FRAMES_H)
+#define EPD_FRAMES_H 1
+
+#include <Arduino.h>
+#include <EPD_FLASH.h>
+
+// records in a chain, a key then deltas; each is a decoder while reading
+#if !defined(EPD_FRAMES_CHAIN)
+#define EPD_FRAMES_CHAIN 4
+#endif
+
+// the largest frame whose key record still fits in a sector: PackBits can
+// take a control byte for every 128 bytes on top of the frame, after the
+// 8 byte sector header and the 4 byte record header (4052 bytes, so the
+// 2.0" panel's 2400 byte frame, not the 2.7" panel's 5808)
+#define EPD_FRAMES_MAX_FRAME_SIZE ((EPD_FLASH_SECTOR_SIZE - 8 - 4) * 128 / 129)
+
+class EPD_FRAMES_Class {
+private:
+	// a record's PackBits stream, read a few bytes at a time
+	struct Decoder {
+		uint32_t address; // of the next bytes to fetch
+		uint8_t buffer[16];
+		uint8_t used;     // bytes of buffer taken
+		uint8_t count;    // bytes left in the current run or literal
+		bool run;
+		uint8_t value;
+	};
+
+	uint32_t first;      // address of the ring
+	uint16_t sectors;
+	uint16_t frame_size; // bytes
+
+	uint16_t sector;     // in the ring, where the head is
+	uint32_t sequence;   // of that sector
+	uint32_t head;       // address the next record goes at
+
+	uint8_t chain_length; // 0 until the first write()
+	uint32_t chain[EPD_FRAMES_CHAIN]; // record payload addresses, key first
+
+	Decoder decoders[EPD_FRAMES_CHAIN];
+	uint32_t read_offset; // of the byte the decoders are at
+
+	uint16_t last_record_size;
+
+	uint32_t sector_address(uint16_t ring_sector) const;
+	void next_sector(void);
+	void program(uint32_t address, const uint8_t *data, uint16_t length);
+	uint16_t encode(const uint8_t *image, bool key, uint32_t *address);
+	void restart(void);
+	uint8_t fetch(Decoder &d);
+	uint8_t decode(Decoder &d);
+
+	EPD_FRAMES_Class(const EPD_FRAMES_Class &f);  // prevent copy
+
+public:
+	// keep frames of frame_size bytes (up to EPD_FRAMES_MAX_FRAME_SIZE) in
+	// sector_count sectors (at least 2) from first_sector; there is no
+	// current frame until write().  A larger frame is refused: nothing is
+	// kept, and read() gives white
+	void begin(uint16_t first_sector, uint16_t sector_count, uint16_t frame_size);
+
+	// append image as the current frame
+	void write(const uint8_t *image);
+
+	// length bytes of the current frame from offset (white if there is
+	// none); reading forwards is cheapest, going back decodes from the start
+	void read(void *buffer, uint32_t offset, uint16_t length);
+
+	// bytes the last write() took in flash
+	uint16_t last_size(void) const {
+		return this->last_record_size;
+	}
+
+	EPD_FRAMES_Class(void);
+};
+
+// the default store
+extern EPD_FRAMES_Class EPD_FRAMES;
+
+// an EPD_reader for EPD_Class::frame_cb(): the address is the offset into
+// the current frame
+void EPD_FRAMES_reader(void *buffer, uint32_t address, uint16_t length);
+
+#endif
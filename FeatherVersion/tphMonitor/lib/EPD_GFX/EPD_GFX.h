@@ -15,6 +15,22 @@
 // 2017.01.29 - Mark Busby <mark@BusbyCreations.com>
 //     - Removed S5813A dependence, now requires temperature passed on updated
 //     - Include appropriate EPD header so linter works
+//     - Track changed lines in drawPixel(), add displayPartial()
+//     - Add drawLineDirect(), Bresenham straight into new_image
+//     - Span fills: drawFastHLine(), drawFastVLine(), fillRect() and
+//       fillScreen() write whole bytes of new_image, EPD_GFX_ROTATION fixes
+//       the rotation at compile time
+//     - Add blitText(), the classic font a glyph row at a time from glyphs
+//       cached off drawChar()
+//     - Add saveBackground()/restoreBackground() when EPD_GFX_BACKGROUND is
+//       defined
+//     - restoreBackground() of one rectangle, for widgets that redraw alone
+//     - Keep the image on the panel in EPD_FLASH instead of old_image when
+//       EPD_GFX_FLASH_IMAGE is defined
+//     - Banded rendering with displayBands() when EPD_GFX_BAND_LINES is
+//       defined: new_image holds that many lines, not the whole frame
+//     - Keep the image on the panel compressed in EPD_FRAMES when
+//       EPD_GFX_FLASH_FRAMES is defined
 
 #if !defined(EPD_GFX_H)
 #define EPD_GFX_H 1
@@ -24,6 +40,52 @@
 #include <EPD_V231_G2.h>
 #include <EPD_PANELS.h>
 
+// the characters blitText() keeps glyphs for, 8 bytes each; others are drawn
+// with drawChar()
+#if !defined(EPD_GFX_GLYPHS)
+#define EPD_GFX_GLYPHS " %+,-.0123456789:FHLPTV[]aehmprsu"
+#endif
+
+// define EPD_GFX_FLASH_IMAGE as a sector aligned EPD_FLASH address to keep the
+// image on the panel there, read back a block of lines at a time through
+// frame_cb(), in place of old_image; the panel is cleared instead if the chip
+// is missing
+#if defined(EPD_GFX_FLASH_IMAGE) && EPD_IMAGE_TWO_ARG
+#include <EPD_FLASH.h>
+#define EPD_GFX_OLD_IMAGE_IN_FLASH 1
+#endif
+
+// and define EPD_GFX_FLASH_FRAMES as a number of sectors to keep it there
+// compressed, in an EPD_FRAMES ring of that many sectors: an erase every few
+// tens of refreshes in place of one every refresh
+#if EPD_GFX_OLD_IMAGE_IN_FLASH && defined(EPD_GFX_FLASH_FRAMES)
+#include <EPD_FRAMES.h>
+#if defined(EPD_GFX_BAND_LINES)
+#error "EPD_GFX_FLASH_FRAMES stores whole frames, it can't be used with EPD_GFX_BAND_LINES"
+#endif
+#if EPD_PIXEL_WIDTH * EPD_PIXEL_HEIGHT / 8 > EPD_FRAMES_MAX_FRAME_SIZE
+#error "EPD_GFX_FLASH_FRAMES keeps a frame in one EPD_FLASH sector, this panel's is larger"
+#endif
+#endif
+
+// define EPD_GFX_BAND_LINES to hold only that many panel lines: the frame is
+// drawn by a callback, once per band, as displayBands() sends it to the panel.
+// There is no display(), displayPartial(), background or old_image in this
+// mode, so no buffer grows with the panel
+#if defined(EPD_GFX_BAND_LINES)
+#if EPD_GFX_BAND_LINES < 8
+#error "EPD_GFX_BAND_LINES must be at least 8, blitText() caches glyphs in the band"
+#endif
+#if defined(EPD_GFX_BACKGROUND)
+#error "EPD_GFX_BACKGROUND needs the whole frame, it can't be used with EPD_GFX_BAND_LINES"
+#endif
+#endif
+
+class EPD_GFX;
+
+// draws the whole frame, see displayBands()
+typedef void EPD_GFX_draw(EPD_GFX &gfx);
+
 class EPD_GFX : public Adafruit_GFX {
 
 private:
@@ -34,13 +96,337 @@ private:
 	static const int pixel_width = EPD_PIXEL_WIDTH;  // must be a multiple of 8
 	static const int pixel_height = EPD_PIXEL_HEIGHT;
 
-#if EPD_IMAGE_TWO_ARG
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+	// false if EPD_FLASH did not answer in begin(), so there is no old image
+	bool flash_image;
+#elif EPD_IMAGE_TWO_ARG && !defined(EPD_GFX_BAND_LINES)
+	// displayBands() clears the panel instead, so only a whole frame has one
 	uint8_t old_image[(uint32_t)(pixel_width) * (uint32_t)(pixel_height) / 8];
 #endif
-	uint8_t new_image[(uint32_t)(pixel_width) * (uint32_t)(pixel_height) / 8];
+
+	// new_image holds panel lines band_first..band_last: the whole frame,
+	// unless banded
+#if defined(EPD_GFX_BAND_LINES)
+	static const int image_lines = EPD_GFX_BAND_LINES < pixel_height ? EPD_GFX_BAND_LINES : pixel_height;
+	int16_t band_first;
+	int16_t band_last;
+	int16_t band_lines; // in use, up to image_lines
+	EPD_GFX_draw *band_draw;
+#else
+	static const int image_lines = pixel_height;
+	static const int16_t band_first = 0;
+	static const int16_t band_last = pixel_height - 1;
+#endif
+	uint8_t new_image[(uint32_t)(pixel_width) * (uint32_t)(image_lines) / 8];
+#if defined(EPD_GFX_BACKGROUND)
+	// the parts of the frame that never change, see saveBackground()
+	uint8_t background_image[(uint32_t)(pixel_width) * (uint32_t)(pixel_height) / 8];
+#endif
+
+	// one bit per panel line, set by drawPixel() when the line may differ
+	// from what is on the panel
+	uint8_t dirty_lines[(pixel_height + 7) / 8];
+
+	// each of EPD_GFX_GLYPHS as drawChar() draws it in rotation
+	// glyph_rotation, 8 rows of 6 bits in panel order (bit 0 is the leftmost
+	// panel pixel)
+	static const int glyph_count = sizeof(EPD_GFX_GLYPHS) - 1;
+	uint8_t glyph_rows[glyph_count][8];
+	uint8_t glyph_rotation;
 
 	// EPD_GFX(EPD_Class&);  // disable copy constructor
 
+	// the rotation in use: a constant when EPD_GFX_ROTATION is defined, so
+	// rotate() and the fills below reduce to the one case
+#if defined(EPD_GFX_ROTATION)
+	uint8_t panel_rotation(void) const {
+		return EPD_GFX_ROTATION;
+	}
+#else
+	uint8_t panel_rotation(void) const {
+		return this->rotation;
+	}
+#endif
+
+	// from the current rotation to panel coordinates
+	void rotate(int16_t &x, int16_t &y) {
+		int16_t t;
+		switch (this->panel_rotation()) {
+		case 1:
+			t = x;
+			x = WIDTH  - 1 - y;
+			y = t;
+			break;
+		case 2:
+			x = WIDTH  - 1 - x;
+			y = HEIGHT - 1 - y;
+			break;
+		case 3:
+			t = x;
+			x = y;
+			y = HEIGHT - 1 - t;
+			break;
+		}
+	}
+
+	// panel pixels x0..x1 of one line, both ends included
+	void fill_span(int16_t line, int16_t x0, int16_t x1, uint16_t colour) {
+		uint8_t *image = &this->new_image[(line - this->band_first) * (pixel_width / 8)];
+		int first = x0 / 8;
+		int last = x1 / 8;
+		uint8_t first_mask = 0xff << (x0 & 0x07);
+		uint8_t last_mask = 0xff >> (7 - (x1 & 0x07));
+		if (first == last) {
+			first_mask &= last_mask;
+		}
+		if (BLACK == colour) {
+			image[first] |= first_mask;
+		} else {
+			image[first] &= ~first_mask;
+		}
+		if (first == last) {
+			return;
+		}
+		memset(&image[first + 1], BLACK == colour ? 0xff : 0x00, last - first - 1);
+		if (BLACK == colour) {
+			image[last] |= last_mask;
+		} else {
+			image[last] &= ~last_mask;
+		}
+	}
+
+	void mark_dirty(int16_t y0, int16_t y1) {
+		for (int16_t line = y0; line <= y1; ++line) {
+			this->dirty_lines[line / 8] |= 0x01 << (line & 0x07);
+		}
+	}
+
+	// a rectangle in the current rotation is a rectangle on the panel: clip
+	// it, and turn two corners to give panel x..x1, lines y..y1; false if
+	// nothing is left
+	bool panel_rect(int16_t &x, int16_t &y, int16_t w, int16_t h, int16_t &x1, int16_t &y1) {
+		x1 = x + w - 1;
+		y1 = y + h - 1;
+		if (x < 0) {
+			x = 0;
+		}
+		if (y < 0) {
+			y = 0;
+		}
+		if (x1 >= this->_width) {
+			x1 = this->_width - 1;
+		}
+		if (y1 >= this->_height) {
+			y1 = this->_height - 1;
+		}
+		if (w <= 0 || h <= 0 || x > x1 || y > y1) {
+			return false;
+		}
+
+		this->rotate(x, y);
+		this->rotate(x1, y1);
+		if (x > x1) {
+			int16_t t = x; x = x1; x1 = t;
+		}
+		if (y > y1) {
+			int16_t t = y; y = y1; y1 = t;
+		}
+		if (y < this->band_first) {
+			y = this->band_first;
+		}
+		if (y1 > this->band_last) {
+			y1 = this->band_last;
+		}
+		return y <= y1;
+	}
+
+	// draw every glyph at logical (0, 0) and read its rows back off the
+	// panel lines it lands on, then put those lines back as they were
+	void cache_glyphs(void) {
+		const int bytes_per_line = pixel_width / 8;
+		int16_t left = 5, first = 0;
+		int16_t right = 0, last = 7;
+		this->rotate(left, first);
+		this->rotate(right, last);
+		if (left > right) {
+			int16_t t = left; left = right; right = t;
+		}
+		if (first > last) {
+			int16_t t = first; first = last; last = t;
+		}
+
+#if defined(EPD_GFX_BAND_LINES)
+		// borrow the start of the band for the glyph's lines
+		const int16_t band_first = this->band_first;
+		const int16_t band_last = this->band_last;
+		this->band_first = first;
+		this->band_last = last;
+#endif
+		uint8_t lines[8 * bytes_per_line];
+		uint8_t dirty[sizeof(this->dirty_lines)];
+		memcpy(lines, &this->new_image[(first - this->band_first) * bytes_per_line], sizeof(lines));
+		memcpy(dirty, this->dirty_lines, sizeof(dirty));
+		GFXfont *font = this->gfxFont;
+		this->gfxFont = NULL;
+
+		for (int glyph = 0; glyph < glyph_count; ++glyph) {
+			this->drawChar(0, 0, EPD_GFX_GLYPHS[glyph], BLACK, WHITE, 1);
+			for (int16_t row = 0; row < 8; ++row) {
+				int16_t x = 0, line = row;
+				this->rotate(x, line);
+				const uint8_t *image = &this->new_image[(line - this->band_first) * bytes_per_line + left / 8];
+				uint16_t bits = image[0];
+				if (left / 8 + 1 < bytes_per_line) {
+					bits |= image[1] << 8;
+				}
+				this->glyph_rows[glyph][row] = (bits >> (left & 0x07)) & 0x3f;
+			}
+		}
+
+		this->gfxFont = font;
+		memcpy(&this->new_image[(first - this->band_first) * bytes_per_line], lines, sizeof(lines));
+		memcpy(this->dirty_lines, dirty, sizeof(dirty));
+#if defined(EPD_GFX_BAND_LINES)
+		this->band_first = band_first;
+		this->band_last = band_last;
+#endif
+		this->glyph_rotation = this->panel_rotation();
+	}
+
+	// one cached glyph, scaled by size, wholly on screen
+	void blit_glyph(int16_t x, int16_t y, const uint8_t *rows, uint8_t size,
+			uint16_t colour, uint16_t background) {
+		const int bytes_per_line = pixel_width / 8;
+		int16_t left = x, first = y;
+		int16_t right = x + 6 * size - 1, last = y + 8 * size - 1;
+		this->rotate(left, first);
+		this->rotate(right, last);
+		if (left > right) {
+			left = right;
+		}
+		const uint64_t cell = (((uint64_t) 1 << (6 * size)) - 1) << (left & 0x07);
+
+		for (int16_t row = 0; row < 8; ++row) {
+			uint32_t bits = rows[row];
+			if (size > 1) {
+				bits = 0;
+				for (int bit = 0; bit < 6; ++bit) {
+					if (rows[row] & (0x01 << bit)) {
+						bits |= ((1UL << size) - 1) << (bit * size);
+					}
+				}
+			}
+			uint64_t ink = (uint64_t) bits << (left & 0x07);
+			uint64_t set, clear;
+			if (colour == background) {
+				set = BLACK == colour ? ink : 0;
+				clear = BLACK == colour ? 0 : ink;
+			} else {
+				set = BLACK == colour ? ink : cell & ~ink;
+				clear = cell & ~set;
+			}
+
+			for (int16_t repeat = 0; repeat < size; ++repeat) {
+				int16_t line = y + row * size + repeat;
+				int16_t unused = x;
+				this->rotate(unused, line);
+				if (line < this->band_first || line > this->band_last) {
+					continue;
+				}
+				uint8_t *image = &this->new_image[(line - this->band_first) * bytes_per_line + left / 8];
+				for (uint64_t s = set, c = clear; 0 != (s | c); s >>= 8, c >>= 8, ++image) {
+					*image = (*image & ~(uint8_t) c) | (uint8_t) s;
+				}
+			}
+		}
+		this->mark_dirty(first < last ? first : last, first < last ? last : first);
+	}
+
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+	// an EPD_reader for frame_cb(): the old image, from offset into it
+	static void read_flash(void *buffer, uint32_t offset, uint16_t length) {
+#if defined(EPD_GFX_FLASH_FRAMES)
+		EPD_FRAMES.read(buffer, offset, length);
+#else
+		EPD_FLASH.read(buffer, EPD_GFX_FLASH_IMAGE + offset, length);
+#endif
+	}
+
+#if defined(EPD_GFX_FLASH_FRAMES)
+	// new_image is now on the panel: it becomes the old image
+	void store_image(void) {
+		EPD_FRAMES.write(this->new_image);
+	}
+#else
+	// erase the stored image; each of its lines can then be written once
+	void erase_image(void) {
+		const uint32_t size = (uint32_t)(pixel_width) * (uint32_t)(pixel_height) / 8;
+		for (uint32_t offset = 0; offset < size; offset += EPD_FLASH_SECTOR_SIZE) {
+			EPD_FLASH.write_enable();
+			EPD_FLASH.sector_erase(EPD_GFX_FLASH_IMAGE + offset);
+		}
+	}
+
+	// the lines of new_image from band_first on into the erased image, a
+	// page program at a time
+	void write_image(int16_t lines) {
+		uint32_t address = EPD_GFX_FLASH_IMAGE + (uint32_t)(this->band_first) * (pixel_width / 8);
+		const uint8_t *image = this->new_image;
+		for (uint32_t left = (uint32_t)(lines) * (pixel_width / 8); 0 != left; ) {
+			uint16_t length = EPD_FLASH_PAGE_SIZE - address % EPD_FLASH_PAGE_SIZE;
+			if (length > left) {
+				length = left;
+			}
+			EPD_FLASH.write_enable();
+			EPD_FLASH.write(address, image, length);
+			address += length;
+			image += length;
+			left -= length;
+		}
+	}
+
+#if !defined(EPD_GFX_BAND_LINES)
+	// new_image is now on the panel: it becomes the old image
+	void store_image(void) {
+		this->erase_image();
+		this->write_image(pixel_height);
+	}
+#endif
+#endif
+#endif
+
+#if defined(EPD_GFX_BAND_LINES)
+	// start new_image, white, at panel line first
+	void render_band(int16_t first) {
+		this->band_first = first;
+		this->band_last = first + this->band_lines - 1;
+		if (this->band_last >= pixel_height) {
+			this->band_last = pixel_height - 1;
+		}
+		memset(this->new_image, 0, sizeof(this->new_image));
+		if (NULL != this->band_draw) {
+			this->band_draw(*this);
+		}
+	}
+
+	// the EPD_GFX in displayBands(), for read_band()
+	static EPD_GFX *&band_owner(void) {
+		static EPD_GFX *owner = NULL;
+		return owner;
+	}
+
+	// an EPD_reader for frame_cb() that renders each band as its first line
+	// is asked for; the address is the line's offset in the frame
+	static void read_band(void *buffer, uint32_t address, uint16_t length) {
+		EPD_GFX *gfx = band_owner();
+		int16_t line = address / (pixel_width / 8);
+		if (line < gfx->band_first || line > gfx->band_last) {
+			gfx->render_band(line - line % gfx->band_lines);
+		}
+		memcpy(buffer, &gfx->new_image[(line - gfx->band_first) * (pixel_width / 8)], length);
+	}
+#endif
+
 public:
 
 	enum {
@@ -51,7 +437,17 @@ public:
 	// constructor
 	EPD_GFX(EPD_Class &epd) :
 	Adafruit_GFX(this->pixel_width, this->pixel_height),
-		EPD(epd) {
+		EPD(epd),
+#if defined(EPD_GFX_BAND_LINES)
+		band_first(0),
+		band_last(image_lines - 1),
+		band_lines(image_lines),
+		band_draw(NULL),
+#endif
+		glyph_rotation(0xff) {
+#if defined(EPD_GFX_ROTATION)
+		this->setRotation(EPD_GFX_ROTATION);
+#endif
 	}
 
 	void begin(int tempCelcius) {
@@ -62,10 +458,32 @@ public:
 		this->EPD.end();
 
 		// clear buffers to white
-#if EPD_IMAGE_TWO_ARG
+		memset(this->new_image, 0, sizeof(this->new_image));
+		memset(this->dirty_lines, 0, sizeof(this->dirty_lines));
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+		this->flash_image = EPD_FLASH.available();
+#if defined(EPD_GFX_BAND_LINES)
+		if (this->flash_image) {
+			const int16_t band_first = this->band_first;
+			this->erase_image();
+			for (this->band_first = 0; this->band_first < pixel_height; this->band_first += image_lines) {
+				int16_t lines = pixel_height - this->band_first;
+				this->write_image(lines < image_lines ? lines : image_lines);
+			}
+			this->band_first = band_first;
+		}
+#else
+		if (this->flash_image) {
+#if defined(EPD_GFX_FLASH_FRAMES)
+			EPD_FRAMES.begin(EPD_GFX_FLASH_IMAGE >> EPD_FLASH_SECTOR_SHIFT, EPD_GFX_FLASH_FRAMES,
+					 sizeof(this->new_image));
+#endif
+			this->store_image();
+		}
+#endif
+#elif EPD_IMAGE_TWO_ARG && !defined(EPD_GFX_BAND_LINES)
 		memset(this->old_image, 0, sizeof(this->old_image));
 #endif
-		memset(this->new_image, 0, sizeof(this->new_image));
 	}
 
 	void end(void){
@@ -73,39 +491,178 @@ public:
 
 	// set a single pixel in new_image
 	void drawPixel(int16_t x, int16_t y, uint16_t colour) {
-		if (x < 0 || x >= this->pixel_width || y < 0 || y >= this->pixel_height) {
+		if (x < 0 || x >= this->_width || y < 0 || y >= this->_height) {
 			return; // avoid buffer overwrite
 		}
 
-        // pay attention to rotation setting
-        int16_t t;
-        switch(rotation) {
-         case 1:
-          t = x;
-          x = WIDTH  - 1 - y;
-          y = t;
-          break;
-         case 2:
-          x = WIDTH  - 1 - x;
-          y = HEIGHT - 1 - y;
-          break;
-         case 3:
-          t = x;
-          x = y;
-          y = HEIGHT - 1 - t;
-          break;
-        }
+		this->rotate(x, y);
+		if (y < this->band_first || y > this->band_last) {
+			return;
+		}
 
 		int bit = x & 0x07;
-		int byte = x / 8 + y * (pixel_width / 8);
+		int byte = x / 8 + (y - this->band_first) * (pixel_width / 8);
 		int mask = 0x01 << bit;
 		if (BLACK == colour) {
 			this->new_image[byte] |= mask;
 		} else {
 			this->new_image[byte] &= ~mask;
 		}
+		this->dirty_lines[y / 8] |= 0x01 << (y & 0x07);
 	}
 
+	// Bresenham line straight into new_image: the rotation is applied to
+	// the two end points instead of to every pixel through drawPixel()
+	void drawLineDirect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t colour) {
+		this->rotate(x0, y0);
+		this->rotate(x1, y1);
+
+		const int16_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+		const int16_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+		int16_t err = dx + dy;
+		for (;;) {
+			if ((uint16_t) x0 < pixel_width && y0 >= this->band_first && y0 <= this->band_last) {
+				uint8_t *byte = &this->new_image[x0 / 8 + (y0 - this->band_first) * (pixel_width / 8)];
+				uint8_t mask = 0x01 << (x0 & 0x07);
+				if (BLACK == colour) {
+					*byte |= mask;
+				} else {
+					*byte &= ~mask;
+				}
+				this->dirty_lines[y0 / 8] |= 0x01 << (y0 & 0x07);
+			}
+			if (x0 == x1 && y0 == y1) {
+				break;
+			}
+			int16_t e2 = 2 * err;
+			if (e2 >= dy) {
+				err += dy;
+				x0 += sx;
+			}
+			if (e2 <= dx) {
+				err += dx;
+				y0 += sy;
+			}
+		}
+	}
+
+	// fill the rectangle a panel line at a time
+	void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t colour) {
+		int16_t x1, y1;
+		if (!this->panel_rect(x, y, w, h, x1, y1)) {
+			return;
+		}
+		for (int16_t line = y; line <= y1; ++line) {
+			this->fill_span(line, x, x1, colour);
+		}
+		this->mark_dirty(y, y1);
+	}
+
+	void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t colour) {
+		this->fillRect(x, y, w, 1, colour);
+	}
+
+	void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t colour) {
+		this->fillRect(x, y, 1, h, colour);
+	}
+
+	void fillScreen(uint16_t colour) {
+		memset(this->new_image, BLACK == colour ? 0xff : 0x00, sizeof(this->new_image));
+		this->mark_dirty(this->band_first, this->band_last);
+	}
+
+	// horizontal and vertical lines as spans, anything else pixel by pixel
+	void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t colour) {
+		if (y0 == y1) {
+			this->fillRect(x0 < x1 ? x0 : x1, y0, abs(x1 - x0) + 1, 1, colour);
+		} else if (x0 == x1) {
+			this->fillRect(x0, y0 < y1 ? y0 : y1, 1, abs(y1 - y0) + 1, colour);
+		} else {
+			Adafruit_GFX::drawLine(x0, y0, x1, y1, colour);
+		}
+	}
+
+	// text in the classic 6x8 font, the same pixels as print() with wrap
+	// off, but written a glyph row (a byte or two) at a time.  Characters
+	// outside EPD_GFX_GLYPHS, glyphs partly off screen, sizes over 5 and
+	// rotations 1 and 3 go through drawChar()
+	void blitText(int16_t x, int16_t y, const char *text, uint8_t size = 1,
+			uint16_t colour = BLACK, uint16_t background = WHITE) {
+		const bool lines = 0 == (this->panel_rotation() & 0x01);
+		if (lines && this->glyph_rotation != this->panel_rotation()) {
+			this->cache_glyphs();
+		}
+		if (0 == size) {
+			size = 1;
+		}
+		GFXfont *font = this->gfxFont;
+		this->gfxFont = NULL;
+
+		for (int16_t left = x; *text; ++text) {
+			if ('\n' == *text) {
+				left = 0;
+				y += 8 * size;
+				continue;
+			}
+			if ('\r' == *text) {
+				continue;
+			}
+			const char *glyph = strchr(EPD_GFX_GLYPHS, *text);
+			if (lines && NULL != glyph && size <= 5 && left >= 0 && y >= 0 &&
+					left + 6 * size <= this->_width && y + 8 * size <= this->_height) {
+				this->blit_glyph(left, y, this->glyph_rows[glyph - EPD_GFX_GLYPHS], size,
+						colour, background);
+			} else {
+				this->drawChar(left, y, *text, colour, background, size);
+			}
+			left += 6 * size;
+		}
+
+		this->gfxFont = font;
+	}
+
+#if defined(EPD_GFX_BACKGROUND)
+	// keep new_image as it is as the background
+	void saveBackground(void) {
+		memcpy(this->background_image, this->new_image, sizeof(this->background_image));
+	}
+
+	// start the next frame from the background; every line is marked, and
+	// displayPartial() drops those that come out the same as the panel
+	void restoreBackground(void) {
+		memcpy(this->new_image, this->background_image, sizeof(this->new_image));
+		this->mark_dirty(0, pixel_height - 1);
+	}
+
+	// put back the background in one rectangle, marking only its lines
+	void restoreBackground(int16_t x, int16_t y, int16_t w, int16_t h) {
+		int16_t x1, y1;
+		if (!this->panel_rect(x, y, w, h, x1, y1)) {
+			return;
+		}
+		const int bytes_per_line = pixel_width / 8;
+		const int first = x / 8;
+		const int last = x1 / 8;
+		uint8_t first_mask = 0xff << (x & 0x07);
+		uint8_t last_mask = 0xff >> (7 - (x1 & 0x07));
+		if (first == last) {
+			first_mask &= last_mask;
+			last_mask = first_mask;
+		}
+		for (int16_t line = y; line <= y1; ++line) {
+			uint8_t *image = &this->new_image[line * bytes_per_line];
+			const uint8_t *background = &this->background_image[line * bytes_per_line];
+			image[first] = (image[first] & ~first_mask) | (background[first] & first_mask);
+			if (last > first + 1) {
+				memcpy(&image[first + 1], &background[first + 1], last - first - 1);
+			}
+			image[last] = (image[last] & ~last_mask) | (background[last] & last_mask);
+		}
+		this->mark_dirty(y, y1);
+	}
+#endif
+
+#if !defined(EPD_GFX_BAND_LINES)
 	// refresh the display: change from current image to new image
 	void display(int tempCelcius) {
 		// erase old, display new
@@ -115,6 +672,16 @@ public:
 #if defined(EPD_ENABLE_EXTRA_SRAM)
 #if EPD_IMAGE_ONE_ARG
 		this->EPD.image_sram(this->new_image);
+#elif EPD_GFX_OLD_IMAGE_IN_FLASH
+		if (this->flash_image) {
+			this->EPD.image_cb_sram(0, read_flash, this->new_image);
+		} else {
+			// whatever is on the panel -> white, as clear() does
+			this->EPD.frame_fixed_repeat(0xff, EPD_compensate);
+			this->EPD.frame_fixed_repeat(0xff, EPD_white);
+			this->EPD.frame_sram_repeat(this->new_image, EPD_inverse);
+			this->EPD.frame_sram_repeat(this->new_image, EPD_normal);
+		}
 #elif EPD_IMAGE_TWO_ARG
 		this->EPD.image_sram(this->old_image, this->new_image);
 #else
@@ -123,11 +690,123 @@ public:
 #endif
 		this->EPD.end();
 
-#if EPD_IMAGE_TWO_ARG
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+		if (this->flash_image) {
+			this->store_image();
+		}
+#elif EPD_IMAGE_TWO_ARG
 		// copy new over to old
 		memcpy(this->old_image, this->new_image, sizeof(this->old_image));
 #endif
+		memset(this->dirty_lines, 0, sizeof(this->dirty_lines));
+	}
+
+#if EPD_IMAGE_TWO_ARG && EPD_PARTIAL_AVAILABLE && defined(EPD_ENABLE_EXTRA_SRAM)
+	// refresh only the lines that changed since the last display
+	// returns false, without powering the panel, if nothing changed
+	bool displayPartial(int tempCelcius) {
+		const int bytes_per_line = pixel_width / 8;
+
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+		if (!this->flash_image) {
+			// nothing to compare with or to drive the old image from
+			this->display(tempCelcius);
+			return true;
+		}
+#endif
+
+		// drawPixel() only knows a line was touched, keep the lines that
+		// really differ from the panel
+		bool changed = false;
+		for (int line = 0; line < pixel_height; ++line) {
+			uint8_t bit = 0x01 << (line & 0x07);
+			if (0 == (this->dirty_lines[line / 8] & bit)) {
+				continue;
+			}
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+			uint8_t old_line[bytes_per_line];
+			read_flash(old_line, line * bytes_per_line, bytes_per_line);
+#else
+			const uint8_t *old_line = &this->old_image[line * bytes_per_line];
+#endif
+			if (0 == memcmp(old_line,
+					&this->new_image[line * bytes_per_line], bytes_per_line)) {
+				this->dirty_lines[line / 8] &= ~bit;
+			} else {
+				changed = true;
+			}
+		}
+		if (!changed) {
+			return false;
+		}
+
+		this->EPD.begin();
+		this->EPD.setFactor(tempCelcius);
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+		this->EPD.image_cb_sram_partial(0, read_flash, this->new_image, this->dirty_lines);
+		this->EPD.end();
+
+		// lines that were not dirty already match, so all of new_image is on
+		// the panel now; flash can't rewrite lines in place
+		this->store_image();
+#else
+		this->EPD.image_sram_partial(this->old_image, this->new_image, this->dirty_lines);
+		this->EPD.end();
+
+		// copy changed lines of new over to old
+		for (int line = 0; line < pixel_height; ++line) {
+			if (0 != (this->dirty_lines[line / 8] & (0x01 << (line & 0x07)))) {
+				memcpy(&this->old_image[line * bytes_per_line],
+				       &this->new_image[line * bytes_per_line], bytes_per_line);
+			}
+		}
+#endif
+		memset(this->dirty_lines, 0, sizeof(this->dirty_lines));
+		return true;
+	}
+#endif
+#else
+	// refresh the display with the frame draw() makes: draw() is called for
+	// each band of lines (up to EPD_GFX_BAND_LINES) in every frame the
+	// inverse and normal stages send, with drawing outside the band
+	// clipped, so it must draw the same frame each time
+	void displayBands(int tempCelcius, EPD_GFX_draw *draw, int16_t lines = image_lines) {
+		this->band_lines = lines < 1 ? 1 : lines > image_lines ? image_lines : lines;
+		this->band_draw = draw;
+		band_owner() = this;
+
+		this->EPD.begin();
+		this->EPD.setFactor(tempCelcius);
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+		if (this->flash_image) {
+			this->EPD.frame_cb_repeat(0, read_flash, EPD_compensate);
+			this->EPD.frame_cb_repeat(0, read_flash, EPD_white);
+		} else
+#endif
+		{
+			// whatever is on the panel -> white, as clear() does
+			this->EPD.frame_fixed_repeat(0xff, EPD_compensate);
+			this->EPD.frame_fixed_repeat(0xff, EPD_white);
+		}
+		this->band_first = this->band_last = -1;
+		this->EPD.frame_cb_repeat(0, read_band, EPD_inverse, false);
+		this->EPD.frame_cb_repeat(0, read_band, EPD_normal, false);
+		this->EPD.end();
+
+#if EPD_GFX_OLD_IMAGE_IN_FLASH
+		// draw the bands once more to keep the frame as the old image
+		if (this->flash_image) {
+			this->erase_image();
+			for (int16_t first = 0; first < pixel_height; first += this->band_lines) {
+				this->render_band(first);
+				this->write_image(this->band_last - this->band_first + 1);
+			}
+		}
+#endif
+		this->band_draw = NULL;
+		memset(this->dirty_lines, 0, sizeof(this->dirty_lines));
 	}
+#endif
 };
 
 
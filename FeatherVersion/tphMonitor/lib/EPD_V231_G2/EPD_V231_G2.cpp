@@ -18,8 +18,6 @@
 #include <Arduino.h>
 #endif
 
-#include <limits.h>
-
 #include <SPI.h>
 
 #include "EPD_V231_G2.h"
@@ -32,6 +30,15 @@
 #define ARRAY(type, ...) ((type[]){__VA_ARGS__})
 #define CU8(...) (ARRAY(const uint8_t, __VA_ARGS__))
 
+// largest line: command, border, data, scan, data, border (2.70" panel)
+#define LINE_BUFFER_SIZE (1 + 1 + 264 / 8 + 176 / 4 + 264 / 8 + 1)
+
+// lines frame_cb() asks an SPI reader for at once, so SPI is set up again
+// for the panel once per block instead of once per line
+#if !defined(EPD_CB_BLOCK_LINES)
+#define EPD_CB_BLOCK_LINES 8
+#endif
+
 // values for border byte
 #define BORDER_BYTE_BLACK 0xff
 #define BORDER_BYTE_WHITE 0xaa
@@ -39,10 +46,16 @@
 
 static void SPI_on(void);
 static void SPI_off(void);
+static void SPI_resume(void);
 static void SPI_put(uint8_t c);
 static void SPI_send(uint8_t cs_pin, const uint8_t *buffer, uint16_t length);
+static void SPI_send_block(uint8_t cs_pin, uint8_t *buffer, uint16_t length);
 static uint8_t SPI_read(uint8_t cs_pin, const uint8_t *buffer, uint16_t length);
 
+// SPI_on()/SPI_off() calls since the last EPD_Class::begin()
+static uint32_t spi_on_count = 0;
+static uint32_t spi_off_count = 0;
+
 
 EPD_Class::EPD_Class(EPD_size _size,
 		     uint8_t panel_on_pin,
@@ -57,7 +70,8 @@ EPD_Class::EPD_Class(EPD_size _size,
 	EPD_Pin_RESET(reset_pin),
 	EPD_Pin_BUSY(busy_pin),
 	EPD_Pin_EPD_CS(chip_select_pin),
-	size(_size) {
+	size(_size),
+	spi_session(false) {
 
 	this->base_stage_time = 480; // milliseconds
 	this->lines_per_display = 96;
@@ -141,13 +155,23 @@ EPD_Class::EPD_Class(EPD_size _size,
 	this->factored_stage_time = this->base_stage_time; // milliseconds
 	this->setFactor(); // ensure default temperature
 
+	memset(this->stage_repeats, 0, sizeof(this->stage_repeats));
+	memset(this->stage_overshoot_ms, 0, sizeof(this->stage_overshoot_ms));
+	memset(this->stage_elapsed_us, 0, sizeof(this->stage_elapsed_us));
+	this->begin_elapsed_us = 0;
+	this->end_elapsed_us = 0;
+
 }
 
 
 void EPD_Class::begin(void) {
 
+	unsigned long t_start = micros();
+
 	// assume ok
 	this->status = EPD_OK;
+	spi_on_count = 0;
+	spi_off_count = 0;
 
 	// power up sequence
 	digitalWrite(this->EPD_Pin_RESET, LOW);
@@ -274,11 +298,15 @@ void EPD_Class::begin(void) {
 	SPI_send(this->EPD_Pin_EPD_CS, CU8(0x72, 0x40), 2);
 
 	SPI_off();
+
+	this->begin_elapsed_us = micros() - t_start;
 }
 
 
 void EPD_Class::end(void) {
 
+	unsigned long t_start = micros();
+
 	this->nothing_frame();
 
 	if (EPD_2_7 == this->size) {
@@ -328,6 +356,8 @@ void EPD_Class::end(void) {
 	Delay_ms(50);
 
 	this->power_off();
+
+	this->end_elapsed_us = micros() - t_start;
 }
 
 void EPD_Class::power_off(void) {
@@ -348,10 +378,39 @@ void EPD_Class::power_off(void) {
 }
 
 
+uint32_t EPD_Class::spi_begin_count(void) const {
+	return spi_on_count;
+}
+
+
+uint32_t EPD_Class::spi_end_count(void) const {
+	return spi_off_count;
+}
+
+
 // internal functions
 // ==================
 
 
+// keep SPI on for a whole frame repeat instead of cycling it in every line()
+void EPD_Class::spi_session_begin(void) {
+#if !EPD_SPI_PER_LINE
+	if (!this->spi_session) {
+		SPI_on();
+		this->spi_session = true;
+	}
+#endif
+}
+
+
+void EPD_Class::spi_session_end(void) {
+	if (this->spi_session) {
+		SPI_off();
+		this->spi_session = false;
+	}
+}
+
+
 // convert a temperature in Celcius to
 // the scale factor for frame_*_repeat methods
 int EPD_Class::temperature_to_factor_10x(int temperature) const {
@@ -402,209 +461,294 @@ void EPD_Class::frame_sram(const uint8_t *image, EPD_stage stage){
 		this->line(line, &image[line * this->bytes_per_line], 0, false, stage);
 	}
 }
-#endif
 
 
-void EPD_Class::frame_cb(uint32_t address, EPD_reader *reader, EPD_stage stage) {
-	static uint8_t buffer[264 / 8];
+// only the lines set in line_mask are scanned, the rest are left alone
+void EPD_Class::frame_sram_partial(const uint8_t *image, const uint8_t *line_mask, EPD_stage stage){
 	for (uint8_t line = 0; line < this->lines_per_display ; ++line) {
-		reader(buffer, address + line * this->bytes_per_line, this->bytes_per_line);
-		this->line(line, buffer, 0, false, stage);
+		if (0 != (line_mask[line / 8] & (0x01 << (line & 0x07)))) {
+			this->line(line, &image[line * this->bytes_per_line], 0, false, stage);
+		}
+	}
+}
+#endif
+
+
+static uint8_t cb_buffer[EPD_CB_BLOCK_LINES * 264 / 8];
+
+void EPD_Class::frame_cb(uint32_t address, EPD_reader *reader, EPD_stage stage, bool reader_spi) {
+	// a reader that renders lines is asked for one at a time
+	uint8_t block = reader_spi ? EPD_CB_BLOCK_LINES : 1;
+	for (uint8_t line = 0; line < this->lines_per_display ; line += block) {
+		uint8_t lines = this->lines_per_display - line < block ? this->lines_per_display - line : block;
+		reader(cb_buffer, address + line * this->bytes_per_line, lines * this->bytes_per_line);
+		if (reader_spi && this->spi_session) {
+			SPI_resume(); // the reader may have reconfigured or ended SPI
+		}
+		for (uint8_t l = 0; l < lines; ++l) {
+			this->line(line + l, &cb_buffer[l * this->bytes_per_line], 0, false, stage);
+		}
+	}
+}
+
+
+// only the lines set in line_mask are read and scanned, each run of
+// consecutive lines in blocks
+void EPD_Class::frame_cb_partial(uint32_t address, EPD_reader *reader, const uint8_t *line_mask, EPD_stage stage) {
+	for (uint8_t line = 0; line < this->lines_per_display ; ) {
+		uint8_t lines = 0;
+		while (line + lines < this->lines_per_display && lines < EPD_CB_BLOCK_LINES &&
+		       0 != (line_mask[(line + lines) / 8] & (0x01 << ((line + lines) & 0x07)))) {
+			++lines;
+		}
+		if (0 == lines) {
+			++line;
+			continue;
+		}
+		reader(cb_buffer, address + line * this->bytes_per_line, lines * this->bytes_per_line);
+		if (this->spi_session) {
+			SPI_resume(); // the reader may have reconfigured or ended SPI
+		}
+		for (uint8_t l = 0; l < lines; ++l) {
+			this->line(line + l, &cb_buffer[l * this->bytes_per_line], 0, false, stage);
+		}
+		line += lines;
+	}
+}
+
+
+// time the first frame, then run the fewest whole frames that together last
+// at least stage_time; record the repeats and overshoot for the stage
+template <typename Frame>
+void EPD_Class::frame_repeat(EPD_stage stage, long stage_time, Frame frame) {
+	this->spi_session_begin();
+
+	unsigned long t_start = micros();
+	frame();
+	unsigned long frame_time = micros() - t_start;
+
+	long stage_time_us = stage_time * 1000;
+	uint16_t repeats = 1;
+	if ((long)frame_time < stage_time_us) {
+		if (0 == frame_time) {
+			frame_time = 1;
+		}
+		repeats = (stage_time_us + frame_time - 1) / frame_time;
+		for (uint16_t i = 1; i < repeats; ++i) {
+			frame();
+		}
 	}
+	unsigned long elapsed = micros() - t_start;
+
+	this->spi_session_end();
+
+	this->stage_repeats[stage] = repeats;
+	this->stage_overshoot_ms[stage] = ((long)elapsed - stage_time_us) / 1000;
+	this->stage_elapsed_us[stage] = elapsed;
 }
 
 
 void EPD_Class::frame_fixed_repeat(uint8_t fixed_value, EPD_stage stage) {
-	long stage_time = this->factored_stage_time;
-	do {
-		unsigned long t_start = millis();
+	this->frame_repeat(stage, this->factored_stage_time, [&]() {
 		this->frame_fixed(fixed_value, stage);
-		unsigned long t_end = millis();
-		if (t_end > t_start) {
-			stage_time -= t_end - t_start;
-		} else {
-			stage_time -= t_start - t_end + 1 + ULONG_MAX;
-		}
-	} while (stage_time > 0);
+	});
 }
 
 
 void EPD_Class::frame_data_repeat(PROGMEM const uint8_t *image, EPD_stage stage) {
-	long stage_time = this->factored_stage_time;
-	do {
-		unsigned long t_start = millis();
+	this->frame_repeat(stage, this->factored_stage_time, [&]() {
 		this->frame_data(image, stage);
-		unsigned long t_end = millis();
-		if (t_end > t_start) {
-			stage_time -= t_end - t_start;
-		} else {
-			stage_time -= t_start - t_end + 1 + ULONG_MAX;
-		}
-	} while (stage_time > 0);
+	});
 }
 
 
 #if defined(EPD_ENABLE_EXTRA_SRAM)
 void EPD_Class::frame_sram_repeat(const uint8_t *image, EPD_stage stage) {
-	long stage_time = this->factored_stage_time;
-	do {
-		unsigned long t_start = millis();
+	this->frame_repeat(stage, this->factored_stage_time, [&]() {
 		this->frame_sram(image, stage);
-		unsigned long t_end = millis();
-		if (t_end > t_start) {
-			stage_time -= t_end - t_start;
-		} else {
-			stage_time -= t_start - t_end + 1 + ULONG_MAX;
-		}
-	} while (stage_time > 0);
+	});
+}
+
+
+void EPD_Class::frame_sram_partial_repeat(const uint8_t *image, const uint8_t *line_mask, EPD_stage stage) {
+	long stage_time = this->partial_stage_time(line_mask);
+	if (0 == stage_time) {
+		return;
+	}
+	this->frame_repeat(stage, stage_time, [&]() {
+		this->frame_sram_partial(image, line_mask, stage);
+	});
 }
 #endif
 
 
-void EPD_Class::frame_cb_repeat(uint32_t address, EPD_reader *reader, EPD_stage stage) {
-	long stage_time = this->factored_stage_time;
-	do {
-		unsigned long t_start = millis();
-		this->frame_cb(address, reader, stage);
-		unsigned long t_end = millis();
-		if (t_end > t_start) {
-			stage_time -= t_end - t_start;
-		} else {
-			stage_time -= t_start - t_end + 1 + ULONG_MAX;
-		}
-	} while (stage_time > 0);
+void EPD_Class::frame_cb_repeat(uint32_t address, EPD_reader *reader, EPD_stage stage, bool reader_spi) {
+	this->frame_repeat(stage, this->factored_stage_time, [&]() {
+		this->frame_cb(address, reader, stage, reader_spi);
+	});
 }
 
 
-// pixels on display are numbered from 1 so even is actually bits 1,3,5,...
-void EPD_Class::even_pixels(const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage) {
-	for (uint16_t b = 0; b < this->bytes_per_line; ++b) {
-		if (0 != data) {
-#if !defined(__AVR__)
-			uint8_t pixels = data[b] & 0xaa;
-#else
-			// AVR has multiple memory spaces
-			uint8_t pixels;
-			if (read_progmem) {
-				pixels = pgm_read_byte_near(data + b) & 0xaa;
-			} else {
-				pixels = data[b] & 0xaa;
-			}
-#endif
-			switch(stage) {
-			case EPD_compensate:  // B -> W, W -> B (Current Image)
-				pixels = 0xaa | ((pixels ^ 0xaa) >> 1);
-				break;
-			case EPD_white:       // B -> N, W -> W (Current Image)
-				pixels = 0x55 + ((pixels ^ 0xaa) >> 1);
-				break;
-			case EPD_inverse:     // B -> N, W -> B (New Image)
-				pixels = 0x55 | (pixels ^ 0xaa);
-				break;
-			case EPD_normal:       // B -> B, W -> W (New Image)
-				pixels = 0xaa | (pixels >> 1);
-				break;
-			}
-			uint8_t p1 = (pixels >> 6) & 0x03;
-			uint8_t p2 = (pixels >> 4) & 0x03;
-			uint8_t p3 = (pixels >> 2) & 0x03;
-			uint8_t p4 = (pixels >> 0) & 0x03;
-			pixels = (p1 << 0) | (p2 << 2) | (p3 << 4) | (p4 << 6);
-			SPI_put(pixels);
-		} else {
-			SPI_put(fixed_value);
+void EPD_Class::frame_cb_partial_repeat(uint32_t address, EPD_reader *reader, const uint8_t *line_mask, EPD_stage stage) {
+	long stage_time = this->partial_stage_time(line_mask);
+	if (0 == stage_time) {
+		return;
+	}
+	this->frame_repeat(stage, stage_time, [&]() {
+		this->frame_cb_partial(address, reader, line_mask, stage);
+	});
+}
+
+
+// a line is only driven while it is scanned, so a frame of n lines needs
+// n / lines_per_display of the stage time to drive each line as long as a
+// full frame would; 0 if line_mask is empty
+long EPD_Class::partial_stage_time(const uint8_t *line_mask) const {
+	uint16_t lines = 0;
+	for (uint8_t line = 0; line < this->lines_per_display ; ++line) {
+		if (0 != (line_mask[line / 8] & (0x01 << (line & 0x07)))) {
+			++lines;
 		}
 	}
+	return (long)this->factored_stage_time * lines / this->lines_per_display;
+}
+
+
+// stage lookup tables
+// ===================
+//
+// every data byte of every line is converted to panel pixels according to the
+// stage; the conversions are done once, at compile time, into one 256 entry
+// table per stage for each of the three line layouts
+
+// B -> W, W -> B (Current Image)
+// B -> N, W -> W (Current Image)
+// B -> N, W -> B (New Image)
+// B -> B, W -> W (New Image)
+
+// pixels on display are numbered from 1 so even is actually bits 1,3,5,...
+static constexpr uint8_t even_stage(EPD_stage stage, uint8_t pixels) {
+	return stage == EPD_compensate ? (uint8_t)(0xaa | ((pixels ^ 0xaa) >> 1))
+	     : stage == EPD_white      ? (uint8_t)(0x55 + ((pixels ^ 0xaa) >> 1))
+	     : stage == EPD_inverse    ? (uint8_t)(0x55 | (pixels ^ 0xaa))
+	     :                           (uint8_t)(0xaa | (pixels >> 1));
+}
+
+// reverse the order of the four 2 bit pixels in a byte
+static constexpr uint8_t reverse_pairs(uint8_t pixels) {
+	return (uint8_t)((((pixels >> 6) & 0x03) << 0) | (((pixels >> 4) & 0x03) << 2) |
+			 (((pixels >> 2) & 0x03) << 4) | (((pixels >> 0) & 0x03) << 6));
+}
+
+static constexpr uint8_t even_pixel(EPD_stage stage, uint8_t data) {
+	return reverse_pairs(even_stage(stage, data & 0xaa));
 }
 
 // pixels on display are numbered from 1 so odd is actually bits 0,2,4,...
-void EPD_Class::odd_pixels(const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage) {
-	for (uint16_t b = this->bytes_per_line; b > 0; --b) {
-		if (0 != data) {
-#if !defined(__AVR__)
-			uint8_t pixels = data[b - 1] & 0x55;
+static constexpr uint8_t odd_stage(EPD_stage stage, uint8_t pixels) {
+	return stage == EPD_compensate ? (uint8_t)(0xaa | (pixels ^ 0x55))
+	     : stage == EPD_white      ? (uint8_t)(0x55 + (pixels ^ 0x55))
+	     : stage == EPD_inverse    ? (uint8_t)(0x55 | ((pixels ^ 0x55) << 1))
+	     :                           (uint8_t)(0xaa | pixels);
+}
+
+static constexpr uint8_t odd_pixel(EPD_stage stage, uint8_t data) {
+	return odd_stage(stage, data & 0x55);
+}
+
+// interleave bits: (byte)76543210 -> (16 bit).7.6.5.4.3.2.1
+static constexpr uint16_t spread_bits(uint16_t value, uint8_t shift, uint16_t mask) {
+	return (value | (value << shift)) & mask;
+}
+
+static constexpr uint16_t interleave_bits(uint16_t value) {
+	return spread_bits(spread_bits(spread_bits(value, 4, 0x0f0f), 2, 0x3333), 1, 0x5555);
+}
+
+static constexpr uint16_t all_stage(EPD_stage stage, uint16_t pixels) {
+	return stage == EPD_compensate ? (uint16_t)(0xaaaa | (pixels ^ 0x5555))
+	     : stage == EPD_white      ? (uint16_t)(0x5555 + (pixels ^ 0x5555))
+	     : stage == EPD_inverse    ? (uint16_t)(0x5555 | ((pixels ^ 0x5555) << 1))
+	     :                           (uint16_t)(0xaaaa | pixels);
+}
+
+static constexpr uint16_t all_pixel(EPD_stage stage, uint8_t data) {
+	return all_stage(stage, interleave_bits(data));
+}
+
+// expand f(stage, 0) .. f(stage, 255) and one row per stage
+#define TABLE_4(f, stage, n)   f(stage, n), f(stage, n + 1), f(stage, n + 2), f(stage, n + 3)
+#define TABLE_16(f, stage, n)  TABLE_4(f, stage, n), TABLE_4(f, stage, n + 4), \
+			       TABLE_4(f, stage, n + 8), TABLE_4(f, stage, n + 12)
+#define TABLE_64(f, stage, n)  TABLE_16(f, stage, n), TABLE_16(f, stage, n + 16), \
+			       TABLE_16(f, stage, n + 32), TABLE_16(f, stage, n + 48)
+#define TABLE_256(f, stage)    TABLE_64(f, stage, 0), TABLE_64(f, stage, 64), \
+			       TABLE_64(f, stage, 128), TABLE_64(f, stage, 192)
+#define STAGE_TABLES(f)        { { TABLE_256(f, EPD_compensate) }, { TABLE_256(f, EPD_white) }, \
+				 { TABLE_256(f, EPD_inverse) }, { TABLE_256(f, EPD_normal) } }
+
+static constexpr uint8_t even_table[4][256] PROGMEM = STAGE_TABLES(even_pixel);
+static constexpr uint8_t odd_table[4][256] PROGMEM = STAGE_TABLES(odd_pixel);
+static constexpr uint16_t all_table[4][256] PROGMEM = STAGE_TABLES(all_pixel);
+
+// AVR has multiple memory spaces
+#if defined(__AVR__)
+#define TABLE_BYTE(entry) pgm_read_byte_near(&(entry))
+#define TABLE_WORD(entry) pgm_read_word_near(&(entry))
+#define DATA_BYTE(data, b) (read_progmem ? pgm_read_byte_near((data) + (b)) : (data)[b])
 #else
-			// AVR has multiple memory spaces
-			uint8_t pixels;
-			if (read_progmem) {
-				pixels = pgm_read_byte_near(data + b- 1) & 0x55;
-			} else {
-				pixels = data[b - 1] & 0x55;
-			}
+#define TABLE_BYTE(entry) (entry)
+#define TABLE_WORD(entry) (entry)
+#define DATA_BYTE(data, b) ((void)read_progmem, (data)[b])
 #endif
-			switch(stage) {
-			case EPD_compensate:  // B -> W, W -> B (Current Image)
-				pixels = 0xaa | (pixels ^ 0x55);
-				break;
-			case EPD_white:       // B -> N, W -> W (Current Image)
-				pixels = 0x55 + (pixels ^ 0x55);
-				break;
-			case EPD_inverse:     // B -> N, W -> B (New Image)
-				pixels = 0x55 | ((pixels ^ 0x55) << 1);
-				break;
-			case EPD_normal:       // B -> B, W -> W (New Image)
-				pixels = 0xaa | pixels;
-				break;
-			}
-			SPI_put(pixels);
-		} else {
-			SPI_put(fixed_value);
-		}
+
+
+uint8_t *EPD_Class::even_pixels(uint8_t *buffer, const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage) {
+	if (0 == data) {
+		memset(buffer, fixed_value, this->bytes_per_line);
+		return buffer + this->bytes_per_line;
+	}
+	const uint8_t *table = even_table[stage];
+	for (uint16_t b = 0; b < this->bytes_per_line; ++b) {
+		*buffer++ = TABLE_BYTE(table[DATA_BYTE(data, b)]);
 	}
+	return buffer;
 }
 
-// interleave bits: (byte)76543210 -> (16 bit).7.6.5.4.3.2.1
-static inline uint16_t interleave_bits(uint16_t value) {
-	value = (value | (value << 4)) & 0x0f0f;
-	value = (value | (value << 2)) & 0x3333;
-	value = (value | (value << 1)) & 0x5555;
-	return value;
+uint8_t *EPD_Class::odd_pixels(uint8_t *buffer, const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage) {
+	if (0 == data) {
+		memset(buffer, fixed_value, this->bytes_per_line);
+		return buffer + this->bytes_per_line;
+	}
+	const uint8_t *table = odd_table[stage];
+	for (uint16_t b = this->bytes_per_line; b > 0; --b) {
+		*buffer++ = TABLE_BYTE(table[DATA_BYTE(data, b - 1)]);
+	}
+	return buffer;
 }
 
 // pixels on display are numbered from 1
-void EPD_Class::all_pixels(const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage) {
+uint8_t *EPD_Class::all_pixels(uint8_t *buffer, const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage) {
+	if (NULL == data) {
+		memset(buffer, fixed_value, 2 * this->bytes_per_line);
+		return buffer + 2 * this->bytes_per_line;
+	}
+	const uint16_t *table = all_table[stage];
 	for (uint16_t b = this->bytes_per_line; b > 0; --b) {
-		if (NULL != data) {
-#if !defined(__AVR__)
-			uint8_t px = data[b - 1];
-#else
-			// AVR has multiple memory spaces
-			uint8_t px;
-			if (read_progmem) {
-				px = pgm_read_byte_near(data + b - 1);
-			} else {
-				px = data[b - 1];
-			}
-#endif
-			uint16_t pixels = interleave_bits(px);
-			switch(stage) {
-			case EPD_compensate:  // B -> W, W -> B (Current Image)
-				pixels = 0xaaaa | (pixels ^ 0x5555);
-				break;
-			case EPD_white:       // B -> N, W -> W (Current Image)
-				pixels = 0x5555 + (pixels ^ 0x5555);
-				break;
-			case EPD_inverse:     // B -> N, W -> B (New Image)
-				pixels = 0x5555 | ((pixels ^ 0x5555) << 1);
-				break;
-			case EPD_normal:       // B -> B, W -> W (New Image)
-				pixels = 0xaaaa | pixels;
-				break;
-			}
-			SPI_put(pixels >> 8);
-			SPI_put(pixels);
-		} else {
-			SPI_put(fixed_value);
-			SPI_put(fixed_value);
-		}
+		uint16_t pixels = TABLE_WORD(table[DATA_BYTE(data, b - 1)]);
+		*buffer++ = pixels >> 8;
+		*buffer++ = pixels;
 	}
+	return buffer;
 }
 
 
 void EPD_Class::nothing_frame() {
+	this->spi_session_begin();
 	for (int line = 0; line < this->lines_per_display; ++line) {
 		this->line(0x7fffu, 0, 0x00, false, EPD_compensate);
 	}
+	this->spi_session_end();
 }
 
 
@@ -619,26 +763,20 @@ void EPD_Class::border_dummy_line() {
 
 
 // output one line of scan and data bytes to the display
+// the whole line is assembled in line_buffer and sent as one block transfer
 void EPD_Class::line(uint16_t line, const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage) {
+	static uint8_t line_buffer[LINE_BUFFER_SIZE];
+	uint8_t *p = line_buffer;
 
-	SPI_on();
-
-	// send data
-	Delay_us(10);
-	SPI_send(this->EPD_Pin_EPD_CS, CU8(0x70, 0x0a), 2);
-	Delay_us(10);
-
-	// CS low
-	digitalWrite(this->EPD_Pin_EPD_CS, LOW);
-	SPI_put(0x72);
+	*p++ = 0x72;
 
 	if (this->pre_border_byte) {
-		SPI_put(0x00);
+		*p++ = 0x00;
 	}
 
 	if (this->middle_scan) {
 		// data bytes
-		this->odd_pixels(data, fixed_value, read_progmem, stage);
+		p = this->odd_pixels(p, data, fixed_value, read_progmem, stage);
 
 		// scan line
 		for (uint16_t b = this->bytes_per_scan; b > 0; --b) {
@@ -646,11 +784,11 @@ void EPD_Class::line(uint16_t line, const uint8_t *data, uint8_t fixed_value, bo
 			if (line / 4 == b - 1) {
 				n = 0x03 << (2 * (line & 0x03));
 			}
-			SPI_put(n);
+			*p++ = n;
 		}
 
 		// data bytes
-		this->even_pixels(data, fixed_value, read_progmem, stage);
+		p = this->even_pixels(p, data, fixed_value, read_progmem, stage);
 
 	} else {
 		// even scan line, but as lines on display are numbered from 1, line: 1,3,5,...
@@ -659,11 +797,11 @@ void EPD_Class::line(uint16_t line, const uint8_t *data, uint8_t fixed_value, bo
 			if (0 != (line & 0x01) && line / 8 == b) {
 				n = 0xc0 >> (line & 0x06);
 			}
-			SPI_put(n);
+			*p++ = n;
 		}
 
 		// data bytes
-		this->all_pixels(data, fixed_value, read_progmem, stage);
+		p = this->all_pixels(p, data, fixed_value, read_progmem, stage);
 
 		// odd scan line, but as lines on display are numbered from 1, line: 0,2,4,6,...
 		for (uint16_t b = this->bytes_per_scan; b > 0; --b) {
@@ -671,7 +809,7 @@ void EPD_Class::line(uint16_t line, const uint8_t *data, uint8_t fixed_value, bo
 			if (0 == (line & 0x01) && line / 8 == b - 1) {
 				n = 0x03 << (line & 0x06);
 			}
-			SPI_put(n);
+			*p++ = n;
 		}
 	}
 
@@ -681,7 +819,7 @@ void EPD_Class::line(uint16_t line, const uint8_t *data, uint8_t fixed_value, bo
 		break;
 
 	case EPD_BORDER_BYTE_ZERO:  // border byte == 0x00 requred
-		SPI_put(0x00);
+		*p++ = 0x00;
 		break;
 
 	case EPD_BORDER_BYTE_SET:   // border byte needs to be set
@@ -689,27 +827,38 @@ void EPD_Class::line(uint16_t line, const uint8_t *data, uint8_t fixed_value, bo
 		case EPD_compensate:
 		case EPD_white:
 		case EPD_inverse:
-			SPI_put(0x00);
+			*p++ = 0x00;
 			break;
 		case EPD_normal:
-			SPI_put(0xaa);
+			*p++ = 0xaa;
 			break;
 		}
 		break;
 	}
 
-       // CS high
-       digitalWrite(this->EPD_Pin_EPD_CS, HIGH);
+	if (!this->spi_session) {
+		SPI_on();
+	}
+
+	// send data
+	Delay_us(10);
+	SPI_send(this->EPD_Pin_EPD_CS, CU8(0x70, 0x0a), 2);
+	Delay_us(10);
+
+	SPI_send_block(this->EPD_Pin_EPD_CS, line_buffer, p - line_buffer);
 
-       // output data to panel
-       SPI_send(this->EPD_Pin_EPD_CS, CU8(0x70, 0x02), 2);
-       SPI_send(this->EPD_Pin_EPD_CS, CU8(0x72, 0x07), 2);
+	// output data to panel
+	SPI_send(this->EPD_Pin_EPD_CS, CU8(0x70, 0x02), 2);
+	SPI_send(this->EPD_Pin_EPD_CS, CU8(0x72, 0x07), 2);
 
-       SPI_off();
+	if (!this->spi_session) {
+		SPI_off();
+	}
 }
 
 
 static void SPI_on(void) {
+	++spi_on_count;
 	SPI.end();
 	SPI.begin();
 	SPI.setBitOrder(MSBFIRST);
@@ -727,7 +876,23 @@ static void SPI_on(void) {
 }
 
 
+// put the panel's SPI settings back after someone else used the bus, e.g.
+// an EPD_FLASH read, which ends SPI; the reader leaves the bus idle, so none
+// of SPI_on()'s flushing is needed (and it isn't counted as one)
+static void SPI_resume(void) {
+	SPI.begin();
+	SPI.setBitOrder(MSBFIRST);
+#if defined(__MSP432P401R__)
+	SPI.setDataMode(SPI_MODE3);
+#else
+	SPI.setDataMode(SPI_MODE0);
+#endif
+	SPI.setClockDivider(SPI_CLOCK_DIV2);
+}
+
+
 static void SPI_off(void) {
+	++spi_off_count;
 	// SPI.begin();
 	// SPI.setBitOrder(MSBFIRST);
 	SPI.setDataMode(SPI_MODE0);
@@ -757,6 +922,25 @@ static void SPI_send(uint8_t cs_pin, const uint8_t *buffer, uint16_t length) {
 	digitalWrite(cs_pin, HIGH);
 }
 
+// send a buffer in one transfer, the buffer is overwritten with the bytes
+// read back
+static void SPI_send_block(uint8_t cs_pin, uint8_t *buffer, uint16_t length) {
+	// CS low
+	digitalWrite(cs_pin, LOW);
+
+	// send all data
+#if defined(ENERGIA)
+	for (uint16_t i = 0; i < length; ++i) {
+		SPI_put(buffer[i]);
+	}
+#else
+	SPI.transfer(buffer, length);
+#endif
+
+	// CS high
+	digitalWrite(cs_pin, HIGH);
+}
+
 #define DEBUG_SPI_READ 0
 static uint8_t SPI_read(uint8_t cs_pin, const uint8_t *buffer, uint16_t length) {
 	// CS low
@@ -43,6 +43,12 @@
 #define EPD_PARTIAL_AVAILABLE 1
 #define EPD_ENABLE_EXTRA_SRAM 1
 
+// set to 1 to power the SPI bus up and down around every line, as the
+// original driver did, instead of once per frame repeat
+#if !defined(EPD_SPI_PER_LINE)
+#define EPD_SPI_PER_LINE      0
+#endif
+
 // display panels supported
 #define EPD_1_44_SUPPORT      1
 #define EPD_1_9_SUPPORT       1
@@ -109,6 +115,14 @@ private:
 
 	EPD_error status;
 
+	bool spi_session;  // SPI is left on between lines
+
+	uint16_t stage_repeats[4];  // frames sent in the last run of each stage
+	int16_t stage_overshoot_ms[4];  // and how far they ran past the stage time
+	uint32_t stage_elapsed_us[4];   // time taken by the last run of each stage
+	uint32_t begin_elapsed_us;      // time taken by the last begin() and end()
+	uint32_t end_elapsed_us;
+
 	PROGMEM const uint8_t *channel_select;
 	uint16_t channel_select_length;
 
@@ -118,6 +132,12 @@ private:
 	void nothing_frame(void);
 	void dummy_line(void);
 	void border_dummy_line(void);
+	void spi_session_begin(void);
+	void spi_session_end(void);
+
+	template <typename Frame>
+	void frame_repeat(EPD_stage stage, long stage_time, Frame frame);
+	long partial_stage_time(const uint8_t *line_mask) const;
 
 public:
 	// power up and power down the EPD panel
@@ -136,6 +156,33 @@ public:
 		return this->status;
 	}
 
+	// number of SPI bus power ups and downs since begin()
+	uint32_t spi_begin_count(void) const;
+	uint32_t spi_end_count(void) const;
+
+	// frames sent in the last run of a stage, and the time in milliseconds
+	// they took beyond the stage time
+	uint16_t repeats(EPD_stage stage) const {
+		return this->stage_repeats[stage];
+	}
+
+	int16_t overshoot_ms(EPD_stage stage) const {
+		return this->stage_overshoot_ms[stage];
+	}
+
+	// microseconds taken by the last run of a stage, begin() and end()
+	uint32_t stage_us(EPD_stage stage) const {
+		return this->stage_elapsed_us[stage];
+	}
+
+	uint32_t begin_us(void) const {
+		return this->begin_elapsed_us;
+	}
+
+	uint32_t end_us(void) const {
+		return this->end_elapsed_us;
+	}
+
 	// clear display (anything -> white)
 	void clear(void) {
 		this->frame_fixed_repeat(0xff, EPD_compensate);
@@ -169,6 +216,35 @@ public:
 		this->frame_sram_repeat(new_image, EPD_inverse);
 		this->frame_sram_repeat(new_image, EPD_normal);
 	}
+
+	// change from old image to new image, but only drive the lines whose bit
+	// is set in line_mask (bit (line & 7) of byte line / 8), all other lines
+	// keep their current image (SRAM version)
+	void image_sram_partial(const uint8_t *old_image, const uint8_t *new_image,
+				const uint8_t *line_mask) {
+		this->frame_sram_partial_repeat(old_image, line_mask, EPD_compensate);
+		this->frame_sram_partial_repeat(old_image, line_mask, EPD_white);
+		this->frame_sram_partial_repeat(new_image, line_mask, EPD_inverse);
+		this->frame_sram_partial_repeat(new_image, line_mask, EPD_normal);
+	}
+
+	// change from an old image fetched by reader (e.g. from EPD_FLASH) to a
+	// new image in SRAM, so only the new image has to be held in memory
+	void image_cb_sram(uint32_t old_address, EPD_reader *reader, const uint8_t *new_image) {
+		this->frame_cb_repeat(old_address, reader, EPD_compensate);
+		this->frame_cb_repeat(old_address, reader, EPD_white);
+		this->frame_sram_repeat(new_image, EPD_inverse);
+		this->frame_sram_repeat(new_image, EPD_normal);
+	}
+
+	// image_cb_sram() for the lines set in line_mask only
+	void image_cb_sram_partial(uint32_t old_address, EPD_reader *reader,
+				   const uint8_t *new_image, const uint8_t *line_mask) {
+		this->frame_cb_partial_repeat(old_address, reader, line_mask, EPD_compensate);
+		this->frame_cb_partial_repeat(old_address, reader, line_mask, EPD_white);
+		this->frame_sram_partial_repeat(new_image, line_mask, EPD_inverse);
+		this->frame_sram_partial_repeat(new_image, line_mask, EPD_normal);
+	}
 #endif
 
 	// Low level API calls
@@ -179,24 +255,31 @@ public:
 	void frame_data(PROGMEM const uint8_t *new_image, EPD_stage stage);
 #if defined(EPD_ENABLE_EXTRA_SRAM)
 	void frame_sram(const uint8_t *new_image, EPD_stage stage);
+	void frame_sram_partial(const uint8_t *new_image, const uint8_t *line_mask, EPD_stage stage);
 #endif
-	void frame_cb(uint32_t address, EPD_reader *reader, EPD_stage stage);
+	// reader_spi false says the reader leaves SPI alone (e.g. it renders the
+	// line), so SPI need not be set up again after each line is read
+	void frame_cb(uint32_t address, EPD_reader *reader, EPD_stage stage, bool reader_spi = true);
+	void frame_cb_partial(uint32_t address, EPD_reader *reader, const uint8_t *line_mask, EPD_stage stage);
 
 	// stage_time frame refresh
 	void frame_fixed_repeat(uint8_t fixed_value, EPD_stage stage);
 	void frame_data_repeat(PROGMEM const uint8_t *new_image, EPD_stage stage);
 #if defined(EPD_ENABLE_EXTRA_SRAM)
 	void frame_sram_repeat(const uint8_t *new_image, EPD_stage stage);
+	void frame_sram_partial_repeat(const uint8_t *new_image, const uint8_t *line_mask, EPD_stage stage);
 #endif
-	void frame_cb_repeat(uint32_t address, EPD_reader *reader, EPD_stage stage);
+	void frame_cb_repeat(uint32_t address, EPD_reader *reader, EPD_stage stage, bool reader_spi = true);
+	void frame_cb_partial_repeat(uint32_t address, EPD_reader *reader, const uint8_t *line_mask, EPD_stage stage);
 
 	// convert temperature to compensation factor
 	int temperature_to_factor_10x(int temperature) const;
 
-	// called by line()
-	void even_pixels(const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage);
-	void odd_pixels(const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage);
-	void all_pixels(const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage);
+	// called by line(), convert one line of image data into buffer and
+	// return the position after the last byte written
+	uint8_t *even_pixels(uint8_t *buffer, const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage);
+	uint8_t *odd_pixels(uint8_t *buffer, const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage);
+	uint8_t *all_pixels(uint8_t *buffer, const uint8_t *data, uint8_t fixed_value, bool read_progmem, EPD_stage stage);
 
 	// single line display - very low-level
 	// also has to handle AVR progmem
@@ -0,0 +1,25 @@
+// Adafruit_BMP280.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Stand-in for the Adafruit BMP280 library, reading the simulated weather.
+// Each read costs the I2C time of the real library's register accesses.
+
+#ifndef ADAFRUIT_BMP280_H
+#define ADAFRUIT_BMP280_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define BMP280_ADDRESS 0x77
+
+class Adafruit_BMP280 {
+public:
+    bool begin(uint8_t addr = BMP280_ADDRESS);
+    float readTemperature(void);
+    float readPressure(void);
+    float readAltitude(float seaLevelhPa = 1013.25);
+};
+
+#endif // ADAFRUIT_BMP280_H
@@ -0,0 +1,151 @@
+// Adafruit_GFX.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Generic primitives follow the Adafruit_GFX implementation
+
+#include <Adafruit_GFX.h>
+
+#define _swap_int16_t(a, b) { int16_t t = a; a = b; b = t; }
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h) {
+    _width = WIDTH;
+    _height = HEIGHT;
+    rotation = 0;
+    cursor_y = cursor_x = 0;
+    textsize = 1;
+    textcolor = textbgcolor = 0xFFFF;
+    wrap = true;
+    gfxFont = NULL;
+}
+
+// Bresenham's algorithm - thx wikpedia
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    int16_t steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) {
+        _swap_int16_t(x0, y0);
+        _swap_int16_t(x1, y1);
+    }
+
+    if (x0 > x1) {
+        _swap_int16_t(x0, x1);
+        _swap_int16_t(y0, y1);
+    }
+
+    int16_t dx, dy;
+    dx = x1 - x0;
+    dy = abs(y1 - y0);
+
+    int16_t err = dx / 2;
+    int16_t ystep;
+
+    if (y0 < y1) {
+        ystep = 1;
+    } else {
+        ystep = -1;
+    }
+
+    for (; x0 <= x1; x0++) {
+        if (steep) {
+            drawPixel(y0, x0, color);
+        } else {
+            drawPixel(x0, y0, color);
+        }
+        err -= dy;
+        if (err < 0) {
+            y0 += ystep;
+            err += dx;
+        }
+    }
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    drawLine(x, y, x, y + h - 1, color);
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    drawLine(x, y, x + w - 1, y, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    for (int16_t i = x; i < x + w; i++) {
+        drawFastVLine(i, y, h, color);
+    }
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color) {
+    fillRect(0, 0, _width, _height, color);
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+}
+
+// placeholder for the classic 5x7 font: a fixed pattern per character
+static uint8_t glyphColumn(unsigned char c, uint8_t i) {
+    if (c <= ' ') return 0;
+    return (uint8_t) ((c * 0x9d + i * 0x35) ^ (c << i)) & 0x7f;
+}
+
+// Draw a character, classic 6x8 cell
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
+    uint16_t color, uint16_t bg, uint8_t size) {
+    if ((x >= _width) || (y >= _height) || ((x + 6 * size - 1) < 0) || ((y + 8 * size - 1) < 0))
+        return;
+
+    for (int8_t i = 0; i < 6; i++) {
+        uint8_t line = (i < 5) ? glyphColumn(c, i) : 0x0;
+        for (int8_t j = 0; j < 8; j++, line >>= 1) {
+            if (line & 0x1) {
+                if (size == 1) drawPixel(x + i, y + j, color);
+                else fillRect(x + (i * size), y + (j * size), size, size, color);
+            } else if (bg != color) {
+                if (size == 1) drawPixel(x + i, y + j, bg);
+                else fillRect(x + i * size, y + j * size, size, size, bg);
+            }
+        }
+    }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+    if (c == '\n') {
+        cursor_y += textsize * 8;
+        cursor_x = 0;
+    } else if (c != '\r') {
+        if (wrap && ((cursor_x + textsize * 6) > _width)) {
+            cursor_x = 0;
+            cursor_y += textsize * 8;
+        }
+        drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+        cursor_x += textsize * 6;
+    }
+    return 1;
+}
+
+void Adafruit_GFX::setRotation(uint8_t x) {
+    rotation = (x & 3);
+    switch (rotation) {
+    case 0:
+    case 2:
+        _width = WIDTH;
+        _height = HEIGHT;
+        break;
+    case 1:
+    case 3:
+        _width = HEIGHT;
+        _height = WIDTH;
+        break;
+    }
+}
+
+void Adafruit_GFX::getTextBounds(const char *str, int16_t x, int16_t y,
+    int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h) {
+    *x1 = x;
+    *y1 = y;
+    *w = strlen(str) * 6 * textsize;
+    *h = 8 * textsize;
+}
@@ -0,0 +1,72 @@
+// Adafruit_GFX.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Stand-in for the subset of Adafruit_GFX that tphMonitor uses.  The drawing
+// primitives funnel into drawPixel() exactly as the real library does, so the
+// per-pixel cost is the same; glyph shapes are placeholders, not the classic
+// 5x7 font.
+
+#ifndef _ADAFRUIT_GFX_H
+#define _ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+typedef struct {
+    uint8_t *bitmap;
+    void *glyph;
+    uint8_t first, last;
+    uint8_t yAdvance;
+} GFXfont;
+
+class Adafruit_GFX : public Print {
+public:
+    Adafruit_GFX(int16_t w, int16_t h);
+    virtual ~Adafruit_GFX() {}
+
+    // this MUST be defined by the subclass
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    // these MAY be overridden by the subclass to provide device-specific
+    // optimized code, otherwise the generic versions are used
+    virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+    virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    virtual void fillScreen(uint16_t color);
+    virtual void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+    virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+        uint16_t bg, uint8_t size);
+    void setCursor(int16_t x, int16_t y) { cursor_x = x; cursor_y = y; }
+    void setTextColor(uint16_t c) { textcolor = textbgcolor = c; }
+    void setTextColor(uint16_t c, uint16_t bg) { textcolor = c; textbgcolor = bg; }
+    void setTextSize(uint8_t s) { textsize = (s > 0) ? s : 1; }
+    void setTextWrap(boolean w) { wrap = w; }
+    void setFont(const GFXfont *f = NULL) { gfxFont = (GFXfont *) f; }
+    void setRotation(uint8_t r);
+    void getTextBounds(const char *string, int16_t x, int16_t y,
+        int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h);
+
+    virtual size_t write(uint8_t c);
+    using Print::write;
+
+    int16_t width(void) const { return _width; }
+    int16_t height(void) const { return _height; }
+    uint8_t getRotation(void) const { return rotation; }
+    int16_t getCursorX(void) const { return cursor_x; }
+    int16_t getCursorY(void) const { return cursor_y; }
+
+protected:
+    const int16_t WIDTH, HEIGHT; // this is the 'raw' display w/h - never changes
+    int16_t _width, _height; // display w/h as modified by current rotation
+    int16_t cursor_x, cursor_y;
+    uint16_t textcolor, textbgcolor;
+    uint8_t textsize;
+    uint8_t rotation;
+    boolean wrap;
+    GFXfont *gfxFont;
+};
+
+#endif // _ADAFRUIT_GFX_H
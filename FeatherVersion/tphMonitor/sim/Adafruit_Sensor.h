@@ -0,0 +1,13 @@
+// Adafruit_Sensor.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Nothing from the unified sensor library is used directly
+
+#ifndef ADAFRUIT_SENSOR_H
+#define ADAFRUIT_SENSOR_H
+
+#include <Arduino.h>
+
+#endif // ADAFRUIT_SENSOR_H
@@ -0,0 +1,200 @@
+// Arduino.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Virtual clock, pins and Serial for the Arduino core stand-in
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "HostSim.h"
+
+#define SIM_PINS 32
+#define SIM_VBATPIN A7
+
+static uint64_t clock_ns = 0;
+static uint8_t pinValue[SIM_PINS];
+static uint8_t pinModes[SIM_PINS];
+static uint32_t pinEdgeCount[SIM_PINS];
+static uint16_t batteryMillivolts = 4100;
+static void (*pinIsr[SIM_PINS])(void);
+static int pinIsrMode[SIM_PINS];
+static uint64_t standbyNs = 0;
+
+SimSerial Serial;
+
+static uint32_t heapCount = 0;
+static bool heapIsSettled = false;
+
+uint32_t sim::heapAllocations() {
+    return heapCount;
+}
+
+void sim::heapSettled() {
+    heapIsSettled = true;
+}
+
+// the firmware's operator new, counted, as the board's DEBUG build does
+static void *heapAllocate(size_t size) {
+    heapCount++;
+    if (heapIsSettled) {
+        fprintf(stderr, "heap allocation of %lu bytes after setup()\n", (unsigned long) size);
+        abort();
+    }
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == NULL) abort();
+    return ptr;
+}
+
+void *operator new(size_t size) { return heapAllocate(size); }
+void *operator new[](size_t size) { return heapAllocate(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+uint64_t sim::now_us() {
+    return clock_ns / 1000;
+}
+
+void sim::advance_us(uint64_t us) {
+    clock_ns += us * 1000;
+}
+
+void sim::advance_ns(uint64_t ns) {
+    clock_ns += ns;
+}
+
+uint8_t sim::pinState(uint8_t pin) {
+    return pin < SIM_PINS ? pinValue[pin] : LOW;
+}
+
+void sim::setPinInput(uint8_t pin, uint8_t value) {
+    if (pin >= SIM_PINS || pinValue[pin] == value) return;
+    pinValue[pin] = value;
+    int mode = pinIsrMode[pin];
+    if (pinIsr[pin] != NULL && (mode == CHANGE || (mode == FALLING && value == LOW)
+        || (mode == RISING && value == HIGH))) {
+        pinIsr[pin]();
+    }
+}
+
+uint32_t sim::pinEdges(uint8_t pin) {
+    return pin < SIM_PINS ? pinEdgeCount[pin] : 0;
+}
+
+void sim::standby() {
+    uint64_t wake = sim::rtcNextInterrupt_us();
+    if (wake == 0) {
+        fprintf(stderr, "sim: standby with no RTC interrupt armed, would never wake\n");
+        exit(1);
+    }
+    if (wake > sim::now_us()) {
+        standbyNs += wake * 1000 - clock_ns;
+        clock_ns = wake * 1000;
+    }
+    sim::rtcInterrupt();
+}
+
+uint64_t sim::standby_us() {
+    return standbyNs / 1000;
+}
+
+void sim::setBatteryMillivolts(uint16_t mV) {
+    batteryMillivolts = mV;
+}
+
+unsigned long millis(void) {
+    return (unsigned long) (clock_ns / 1000000);
+}
+
+unsigned long micros(void) {
+    return (unsigned long) (clock_ns / 1000);
+}
+
+void delay(unsigned long ms) {
+    sim::advance_us((uint64_t) ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    sim::advance_us(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= SIM_PINS) return;
+    pinModes[pin] = mode;
+    if (mode == INPUT_PULLUP) pinValue[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    sim::advance_ns(200);
+    if (pin >= SIM_PINS) return;
+    value = value ? HIGH : LOW;
+    if (pinValue[pin] != value) {
+        pinEdgeCount[pin]++;
+        SPI.chipSelect(pin, value);
+    }
+    pinValue[pin] = value;
+}
+
+int digitalRead(uint8_t pin) {
+    sim::advance_ns(200);
+    return sim::pinState(pin);
+}
+
+int analogRead(uint8_t pin) {
+    sim::advance_us(10);
+    if (pin == SIM_VBATPIN) {
+        // board divides by 2, 3.3V reference, 10 bit resolution
+        return (int) ((uint32_t) batteryMillivolts * 1024 / 2 / 3300);
+    }
+    return 0;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+    if (pin >= SIM_PINS) return;
+    pinIsr[pin] = isr;
+    pinIsrMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < SIM_PINS) pinIsr[pin] = NULL;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(long n, int base) {
+    if (base == DEC && n < 0) {
+        size_t t = print('-');
+        return t + print((unsigned long) -n, base);
+    }
+    return print((unsigned long) n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2) base = 10;
+    do {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+}
+
+size_t Print::print(double number, int digits) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, number);
+    return write(buf);
+}
+
+size_t SimSerial::write(uint8_t c) {
+    if (c != '\r') putchar(c);
+    return 1;
+}
@@ -0,0 +1,122 @@
+// Arduino.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Stand-in for the Arduino core: a virtual clock that jumps forward instead of
+// sleeping, a pin table, and a Serial port that writes to stdout
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define ARDUINO 10800
+#define HOST_SIM_ARDUINO 1
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define LED_BUILTIN 13
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A7 9
+#define SS 16
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+
+#define digitalPinToInterrupt(p) (p)
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// virtual time, in microseconds since power on
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+void setup(void);
+void loop(void);
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) {
+        return str == NULL ? 0 : write((const uint8_t *) str, strlen(str));
+    }
+
+    size_t print(const __FlashStringHelper *s) { return write((const char *) s); }
+    size_t print(const char s[]) { return write(s); }
+    size_t print(char c) { return write((uint8_t) c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long) n, base); }
+    size_t print(int n, int base = DEC) { return print((long) n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long) n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println(void) { return write("\r\n"); }
+    template <typename T> size_t println(T value) {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T> size_t println(T value, int format) {
+        size_t n = print(value, format);
+        return n + println();
+    }
+};
+
+class SimSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    void end(void) {}
+    operator bool() const { return true; }
+    size_t write(uint8_t c);
+    using Print::write;
+};
+
+extern SimSerial Serial;
+
+#endif // ARDUINO_H
@@ -0,0 +1,72 @@
+// HostSim.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Runs setup() once and loop() for a number of wake cycles against the
+// stand-in hardware, then reports what the hardware saw.  Any heap allocation
+// once setup() has returned aborts the run (see DEBUGHEAPSETTLED() in DEBUG.h).
+//
+//     program [cycles]     (default one day: 144 cycles of 10 minutes)
+//
+// TPH_SIM_EPOCH sets the RTC (unix time) at power on, TPH_SIM_SD the
+// directory used as the SD card, and TPH_SIM_FLASH a file the EPD flash is
+// loaded from (if it exists) and saved to, to run on after a reset.
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <SdFat.h>
+#include "HostSim.h"
+
+int main(int argc, char **argv) {
+    unsigned long cycles = 144;
+    if (argc > 1) cycles = strtoul(argv[1], NULL, 10);
+    const char *epoch = getenv("TPH_SIM_EPOCH");
+    if (epoch != NULL) sim::setRtcEpoch(strtoul(epoch, NULL, 10));
+    const char *flash = getenv("TPH_SIM_FLASH");
+    if (flash != NULL) {
+        FILE *f = fopen(flash, "rb");
+        if (f != NULL) {
+            if (fread(SPI.flashImage(), 1, SIM_FLASH_SIZE, f) != SIM_FLASH_SIZE) {
+                fprintf(stderr, "%s: short flash image\n", flash);
+            }
+            fclose(f);
+        }
+    }
+
+    setup();
+    uint64_t setupEnd = sim::now_us();
+    uint32_t setupAllocations = sim::heapAllocations();
+    sim::heapSettled(); // in case setup() didn't say, loop() must not allocate
+    for (unsigned long i = 0; i < cycles; i++) {
+        loop();
+    }
+    uint64_t end = sim::now_us();
+
+    printf("simulated %lu cycles: setup %.3f s, loop %.3f s (%.2f days)\n",
+        cycles, setupEnd / 1e6, (end - setupEnd) / 1e6, (end - setupEnd) / 86400e6);
+    printf("standby %.3f s, awake %.3f s (%.4f%% duty)\n",
+        sim::standby_us() / 1e6, (end - sim::standby_us()) / 1e6,
+        100. * (end - sim::standby_us()) / end);
+    printf("SPI: %u begin, %u end, %u transfers, %u bytes, %u CS edges, stream %08x\n",
+        SPI.stats.begins, SPI.stats.ends, SPI.stats.transfers,
+        SPI.stats.bytes, SPI.stats.csEdges, SPI.stats.hash);
+    printf("EPD flash: %u page programs, %u sector erases, %u bytes read\n",
+        SPI.stats.flashPagePrograms, SPI.stats.flashSectorErases,
+        SPI.stats.flashBytesRead);
+    printf("I2C: %u transactions, %u bytes\n", Wire.stats.transactions, Wire.stats.bytes);
+    printf("heap: %u allocations, all in setup()\n", (unsigned int) setupAllocations);
+    const SimSdStats &sd = sim::sdStats();
+    printf("SD: %u mounts, %u syncs, %u data + %u metadata sector writes, %u bytes\n",
+        sd.mounts, sd.syncs, sd.dataSectorWrites, sd.metaSectorWrites, sd.bytesWritten);
+
+    if (flash != NULL) {
+        FILE *f = fopen(flash, "wb");
+        if (f == NULL || fwrite(SPI.flashImage(), 1, SIM_FLASH_SIZE, f) != SIM_FLASH_SIZE) {
+            fprintf(stderr, "%s: can't save the flash image\n", flash);
+        }
+        if (f != NULL) fclose(f);
+    }
+    return 0;
+}
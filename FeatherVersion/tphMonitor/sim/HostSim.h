@@ -0,0 +1,52 @@
+// HostSim.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Control and inspection of the simulated hardware
+
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+
+#include <Arduino.h>
+
+#define SIM_RTC_INT_PIN A1 // the FeatherWing's INT pad, wired as in Scheduler.hpp
+
+namespace sim {
+    // the virtual clock only moves when the firmware waits or talks to a bus
+    uint64_t now_us();
+    void advance_us(uint64_t us);
+    void advance_ns(uint64_t ns);
+
+    // unix time of the simulated RTC at power on
+    uint32_t rtcEpoch();
+    void setRtcEpoch(uint32_t epoch);
+
+    // PCF8523 timer A and alarm: when INT next goes low (0 if nothing is
+    // armed), and raising it, which sets the flag and pulls SIM_RTC_INT_PIN low
+    uint64_t rtcNextInterrupt_us();
+    void rtcInterrupt();
+
+    // SAMD21 standby: the clock jumps to the next RTC interrupt
+    void standby();
+    uint64_t standby_us();
+
+    // pin state, as the firmware left it
+    uint8_t pinState(uint8_t pin);
+    void setPinInput(uint8_t pin, uint8_t value);
+    uint32_t pinEdges(uint8_t pin);
+
+    // the simulated weather, following the RTC
+    float weatherTemperature_C();
+    float weatherPressure_Pa();
+    float weatherHumidity_percent();
+
+    // operator new calls so far; after heapSettled() any more abort the run
+    uint32_t heapAllocations();
+    void heapSettled();
+
+    // battery voltage in mV seen on VBATPIN
+    void setBatteryMillivolts(uint16_t mV);
+}
+
+#endif // HOSTSIM_H
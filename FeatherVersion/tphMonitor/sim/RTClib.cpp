@@ -0,0 +1,310 @@
+// RTClib.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// DateTime arithmetic follows the Adafruit RTClib implementation
+
+#include <RTClib.h>
+#include <Wire.h>
+#include "HostSim.h"
+
+// PCF8523 read: register pointer plus seven time registers
+#define RTC_READ_US 1000
+
+static uint32_t rtcBase = 1484752187; // 2017.01.18 15:09:47
+
+uint32_t sim::rtcEpoch() {
+    return rtcBase;
+}
+
+void sim::setRtcEpoch(uint32_t epoch) {
+    rtcBase = epoch;
+}
+
+static const uint8_t daysInMonth[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+// number of days since 2000/01/01, valid for 2001..2099
+static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d) {
+    if (y >= 2000) y -= 2000;
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; ++i) days += daysInMonth[i - 1];
+    if (m > 2 && y % 4 == 0) ++days;
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+static long time2long(uint16_t days, uint8_t h, uint8_t m, uint8_t s) {
+    return ((days * 24L + h) * 60 + m) * 60 + s;
+}
+
+static uint8_t conv2d(const char *p) {
+    uint8_t v = 0;
+    if ('0' <= *p && *p <= '9') v = *p - '0';
+    return 10 * v + *++p - '0';
+}
+
+DateTime::DateTime(uint32_t t) {
+    t -= SECONDS_FROM_1970_TO_2000; // bring to 2000 timestamp from 1970
+
+    ss = t % 60;
+    t /= 60;
+    mm = t % 60;
+    t /= 60;
+    hh = t % 24;
+    uint16_t days = t / 24;
+    uint8_t leap;
+    for (yOff = 0; ; ++yOff) {
+        leap = yOff % 4 == 0;
+        if (days < 365u + leap) break;
+        days -= 365 + leap;
+    }
+    for (m = 1; ; ++m) {
+        uint8_t daysPerMonth = daysInMonth[m - 1];
+        if (leap && m == 2) ++daysPerMonth;
+        if (days < daysPerMonth) break;
+        days -= daysPerMonth;
+    }
+    d = days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec) {
+    if (year >= 2000) year -= 2000;
+    yOff = year;
+    m = month;
+    d = day;
+    hh = hour;
+    mm = min;
+    ss = sec;
+}
+
+DateTime::DateTime(const DateTime &copy) :
+    yOff(copy.yOff), m(copy.m), d(copy.d), hh(copy.hh), mm(copy.mm), ss(copy.ss) {
+}
+
+// A convenient constructor for using "the compiler's time":
+//   DateTime now (__DATE__, __TIME__);
+DateTime::DateTime(const char *date, const char *time) {
+    // sample input: date = "Dec 26 2009", time = "12:34:56"
+    yOff = conv2d(date + 9);
+    // Jan Feb Mar Apr May Jun Jul Aug Sep Oct Nov Dec
+    switch (date[0]) {
+    case 'J': m = (date[1] == 'a') ? 1 : ((date[2] == 'n') ? 6 : 7); break;
+    case 'F': m = 2; break;
+    case 'A': m = date[2] == 'r' ? 4 : 8; break;
+    case 'M': m = date[2] == 'r' ? 3 : 5; break;
+    case 'S': m = 9; break;
+    case 'O': m = 10; break;
+    case 'N': m = 11; break;
+    case 'D': m = 12; break;
+    }
+    d = conv2d(date + 4);
+    hh = conv2d(time);
+    mm = conv2d(time + 3);
+    ss = conv2d(time + 6);
+}
+
+DateTime::DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time) :
+    DateTime((const char *) date, (const char *) time) {
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+    uint16_t day = date2days(yOff, m, d);
+    return (day + 6) % 7; // Jan 1, 2000 is a Saturday, i.e. returns 6
+}
+
+uint32_t DateTime::unixtime(void) const {
+    return time2long(date2days(yOff, m, d), hh, mm, ss) + SECONDS_FROM_1970_TO_2000;
+}
+
+long DateTime::secondstime(void) const {
+    return time2long(date2days(yOff, m, d), hh, mm, ss);
+}
+
+DateTime DateTime::operator+(const TimeSpan &span) const {
+    return DateTime(unixtime() + span.totalseconds());
+}
+
+DateTime DateTime::operator-(const TimeSpan &span) const {
+    return DateTime(unixtime() - span.totalseconds());
+}
+
+TimeSpan DateTime::operator-(const DateTime &right) const {
+    return TimeSpan(unixtime() - right.unixtime());
+}
+
+void RTC_PCF8523::adjust(const DateTime &dt) {
+    sim::setRtcEpoch(dt.unixtime() - (uint32_t) (sim::now_us() / 1000000));
+    isSet = true;
+}
+
+DateTime RTC_PCF8523::now() {
+    sim::advance_us(RTC_READ_US);
+    return DateTime(sim::rtcEpoch() + (uint32_t) (sim::now_us() / 1000000));
+}
+
+// PCF8523 registers behind Wire, for the timer A countdown and the alarm.
+// The time registers read the virtual clock; INT is open drain on
+// SIM_RTC_INT_PIN, and only an interrupt output once COF is 111.
+#define PCF8523_REGISTERS 0x14
+#define PCF8523_CONTROL_1 0x00
+#define PCF8523_CONTROL_2 0x01
+#define PCF8523_SECONDS 0x03
+#define PCF8523_MINUTE_ALARM 0x0A
+#define PCF8523_TMR_CLKOUT_CTRL 0x0F
+#define PCF8523_TMR_A_FREQ_CTRL 0x10
+#define PCF8523_TMR_A_REG 0x11
+#define PCF8523_AIE 0x02 // Control_1
+#define PCF8523_CTAIE 0x02 // Control_2
+#define PCF8523_AF 0x08
+#define PCF8523_CTAF 0x40
+#define PCF8523_FLAGS 0xf8 // Control_2 flags: writing 0 clears, 1 keeps
+
+static uint8_t bcd(uint8_t value) {
+    return value / 10 * 16 + value % 10;
+}
+
+class SimPcf8523 : public SimI2cDevice {
+public:
+    SimPcf8523() {
+        memset(regs, 0, sizeof(regs));
+        for (int i = 0; i < 4; i++) regs[PCF8523_MINUTE_ALARM + i] = 0x80;
+        regs[PCF8523_TMR_A_FREQ_CTRL] = 0x07;
+    }
+
+    void i2cWrite(const uint8_t *data, uint8_t length) {
+        if (! length) return;
+        pointer = data[0];
+        bool timerChanged = false;
+        for (uint8_t i = 1; i < length; i++) {
+            uint8_t reg = pointer;
+            pointer = (pointer + 1) % PCF8523_REGISTERS;
+            if (reg == PCF8523_CONTROL_2) {
+                regs[reg] = (data[i] & ~PCF8523_FLAGS) | (regs[reg] & data[i] & PCF8523_FLAGS);
+                continue;
+            }
+            regs[reg] = data[i];
+            if (reg >= PCF8523_TMR_CLKOUT_CTRL) timerChanged = true;
+            if (reg == PCF8523_CONTROL_1 || (reg >= PCF8523_MINUTE_ALARM && reg < PCF8523_MINUTE_ALARM + 4))
+                alarmFrom_us = sim::now_us() + 1;
+        }
+        if (timerChanged) startTimer();
+        driveInt();
+    }
+
+    void i2cRead(uint8_t *data, uint8_t length) {
+        DateTime now(sim::rtcEpoch() + (uint32_t) (sim::now_us() / 1000000));
+        regs[PCF8523_SECONDS] = bcd(now.second());
+        regs[PCF8523_SECONDS + 1] = bcd(now.minute());
+        regs[PCF8523_SECONDS + 2] = bcd(now.hour());
+        regs[PCF8523_SECONDS + 3] = bcd(now.day());
+        regs[PCF8523_SECONDS + 4] = now.dayOfTheWeek();
+        regs[PCF8523_SECONDS + 5] = bcd(now.month());
+        regs[PCF8523_SECONDS + 6] = bcd(now.year() - 2000);
+        for (uint8_t i = 0; i < length; i++) {
+            data[i] = regs[pointer];
+            pointer = (pointer + 1) % PCF8523_REGISTERS;
+        }
+    }
+
+    uint64_t nextInterrupt() {
+        if (! intOutput()) return 0;
+        uint64_t next = 0;
+        if (timerDue_us && (regs[PCF8523_CONTROL_2] & PCF8523_CTAIE)) next = timerDue_us;
+        if (regs[PCF8523_CONTROL_1] & PCF8523_AIE) {
+            uint64_t alarm = nextAlarm();
+            if (alarm && (! next || alarm < next)) next = alarm;
+        }
+        return next;
+    }
+
+    void interrupt() {
+        uint64_t now = sim::now_us();
+        if (timerDue_us && timerDue_us <= now) {
+            regs[PCF8523_CONTROL_2] |= PCF8523_CTAF;
+            timerDue_us += regs[PCF8523_TMR_A_REG] * timerPeriod_us(); // reloads
+        }
+        uint64_t alarm = nextAlarm();
+        if (alarm && alarm <= now) {
+            regs[PCF8523_CONTROL_2] |= PCF8523_AF;
+            alarmFrom_us = alarm + 1;
+        }
+        driveInt();
+    }
+
+private:
+    uint8_t regs[PCF8523_REGISTERS];
+    uint8_t pointer = 0;
+    uint64_t timerDue_us = 0; // virtual time timer A next reaches zero, 0 = stopped
+    uint64_t alarmFrom_us = 0; // the alarm matches from here on
+
+    bool intOutput() {
+        return (regs[PCF8523_TMR_CLKOUT_CTRL] & 0x38) == 0x38;
+    }
+
+    uint64_t timerPeriod_us() {
+        switch (regs[PCF8523_TMR_A_FREQ_CTRL] & 0x07) {
+        case 0: return 244; // 4.096 kHz
+        case 1: return 15625; // 64 Hz
+        case 2: return 1000000; // 1 Hz
+        case 3: return 60000000; // 1/60 Hz
+        default: return 3600000000ULL; // 1/3600 Hz
+        }
+    }
+
+    // the source ticks with the RTC, so the first period is cut short
+    void startTimer() {
+        uint8_t count = regs[PCF8523_TMR_A_REG];
+        if (((regs[PCF8523_TMR_CLKOUT_CTRL] >> 1) & 0x03) != 1 || ! count) {
+            timerDue_us = 0;
+            return;
+        }
+        uint64_t period = timerPeriod_us();
+        uint64_t rtc_us = (uint64_t) sim::rtcEpoch() * 1000000 + sim::now_us();
+        timerDue_us = (rtc_us / period + 1) * period - (uint64_t) sim::rtcEpoch() * 1000000
+            + (count - 1) * period;
+    }
+
+    // first whole minute from alarmFrom_us matching every enabled field
+    uint64_t nextAlarm() {
+        const uint8_t *alarm = regs + PCF8523_MINUTE_ALARM;
+        if ((alarm[0] & alarm[1] & alarm[2] & alarm[3]) & 0x80) return 0;
+        uint64_t epoch_us = (uint64_t) sim::rtcEpoch() * 1000000;
+        uint64_t minute = (epoch_us + alarmFrom_us + 59999999) / 60000000;
+        for (uint32_t i = 0; i < 31 * 1440; i++, minute++) {
+            DateTime at((uint32_t) (minute * 60));
+            if ((alarm[0] & 0x80 || alarm[0] == bcd(at.minute()))
+                && (alarm[1] & 0x80 || alarm[1] == bcd(at.hour()))
+                && (alarm[2] & 0x80 || alarm[2] == bcd(at.day()))
+                && (alarm[3] & 0x80 || alarm[3] == at.dayOfTheWeek())) {
+                return minute * 60000000 - epoch_us;
+            }
+        }
+        return 0;
+    }
+
+    // permanent (TAM = 0) interrupt: low while an enabled flag is set
+    void driveInt() {
+        uint8_t control2 = regs[PCF8523_CONTROL_2];
+        bool active = intOutput()
+            && (((regs[PCF8523_CONTROL_1] & PCF8523_AIE) && (control2 & PCF8523_AF))
+                || ((control2 & PCF8523_CTAIE) && (control2 & PCF8523_CTAF)));
+        sim::setPinInput(SIM_RTC_INT_PIN, active ? LOW : HIGH);
+    }
+};
+
+static SimPcf8523 pcf8523;
+
+bool RTC_PCF8523::begin(void) {
+    static bool attached = false;
+    if (! attached) Wire.attach(0x68, &pcf8523);
+    attached = true;
+    return true;
+}
+
+uint64_t sim::rtcNextInterrupt_us() {
+    return pcf8523.nextInterrupt();
+}
+
+void sim::rtcInterrupt() {
+    pcf8523.interrupt();
+}
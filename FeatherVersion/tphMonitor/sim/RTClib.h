@@ -0,0 +1,78 @@
+// RTClib.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Stand-in for the Adafruit RTClib: DateTime/TimeSpan arithmetic as in the
+// real library, and an RTC_PCF8523 that reads the virtual clock
+
+#ifndef RTCLIB_H
+#define RTCLIB_H
+
+#include <Arduino.h>
+
+#define SECONDS_FROM_1970_TO_2000 946684800
+
+class TimeSpan;
+
+class DateTime {
+public:
+    DateTime(uint32_t t = 0);
+    DateTime(uint16_t year, uint8_t month, uint8_t day,
+        uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+    DateTime(const DateTime &copy);
+    DateTime(const char *date, const char *time);
+    DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time);
+    DateTime &operator=(const DateTime &copy) = default;
+
+    uint16_t year() const { return 2000 + yOff; }
+    uint8_t month() const { return m; }
+    uint8_t day() const { return d; }
+    uint8_t hour() const { return hh; }
+    uint8_t minute() const { return mm; }
+    uint8_t second() const { return ss; }
+    uint8_t dayOfTheWeek() const;
+
+    // 32-bit times as seconds since 1/1/2000
+    long secondstime() const;
+    // 32-bit times as seconds since 1/1/1970
+    uint32_t unixtime(void) const;
+
+    DateTime operator+(const TimeSpan &span) const;
+    DateTime operator-(const TimeSpan &span) const;
+    TimeSpan operator-(const DateTime &right) const;
+
+protected:
+    uint8_t yOff, m, d, hh, mm, ss;
+};
+
+class TimeSpan {
+public:
+    TimeSpan(int32_t seconds = 0) : _seconds(seconds) {}
+    TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds) :
+        _seconds((int32_t) days * 86400L + (int32_t) hours * 3600 + (int32_t) minutes * 60 + seconds) {}
+    int16_t days() const { return _seconds / 86400L; }
+    int8_t hours() const { return _seconds / 3600 % 24; }
+    int8_t minutes() const { return _seconds / 60 % 60; }
+    int8_t seconds() const { return _seconds % 60; }
+    int32_t totalseconds() const { return _seconds; }
+
+    TimeSpan operator+(const TimeSpan &right) const { return TimeSpan(_seconds + right._seconds); }
+    TimeSpan operator-(const TimeSpan &right) const { return TimeSpan(_seconds - right._seconds); }
+
+protected:
+    int32_t _seconds;
+};
+
+class RTC_PCF8523 {
+public:
+    bool begin(void); // also puts the register model on Wire
+    void adjust(const DateTime &dt);
+    bool initialized(void) { return isSet; }
+    static DateTime now();
+
+private:
+    bool isSet = true;
+};
+
+#endif // RTCLIB_H
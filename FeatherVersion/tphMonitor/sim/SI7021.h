@@ -0,0 +1,32 @@
+// SI7021.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Stand-in for the SI7021 library, reading the simulated weather.  Each
+// measurement costs the conversion time of the real sensor.
+
+#ifndef SI7021_H
+#define SI7021_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+typedef struct si7021_env {
+    int celsiusHundredths;
+    int fahrenheitHundredths;
+    unsigned int humidityBasisPoints;
+} si7021_env;
+
+class SI7021 {
+public:
+    bool begin(void) { return true; }
+    bool sensorExists(void) { return true; }
+    int getFahrenheitHundredths(void);
+    int getCelsiusHundredths(void);
+    unsigned int getHumidityPercent(void);
+    unsigned int getHumidityBasisPoints(void);
+    struct si7021_env getHumidityAndTemperature(void);
+};
+
+#endif // SI7021_H
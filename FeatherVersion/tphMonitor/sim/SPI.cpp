@@ -0,0 +1,160 @@
+// SPI.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// SPI bus recorder and MX25V8005 flash model
+
+#include <SPI.h>
+#include "HostSim.h"
+
+SPIClass SPI;
+
+// MX25V8005 command set (see EPD_FLASH.cpp)
+enum {
+    FLASH_WREN = 0x06,
+    FLASH_WRDI = 0x04,
+    FLASH_RDID = 0x9f,
+    FLASH_RDSR = 0x05,
+    FLASH_READ = 0x03,
+    FLASH_FAST_READ = 0x0b,
+    FLASH_SE = 0x20,
+    FLASH_PP = 0x02,
+    FLASH_WEL = 0x02
+};
+
+#define FLASH_PROGRAM_PAGE 256
+#define FLASH_SECTOR 4096
+#define FLASH_PAGE_PROGRAM_US 1400
+#define FLASH_SECTOR_ERASE_US 40000
+
+SPIClass::SPIClass() {
+    memset(&stats, 0, sizeof(stats));
+    memset(flash, 0xff, sizeof(flash)); // a new chip is erased
+}
+
+// time on the wire for one byte: the SAMD core caps the SPI clock at 12 MHz
+static uint32_t byteTime_ns(uint8_t divider) {
+    uint32_t hz = 48000000UL / (divider ? divider : 1);
+    if (hz > 12000000UL) hz = 12000000UL;
+    return 8000000000ULL / hz;
+}
+
+void SPIClass::begin(void) {
+    sim::advance_us(20);
+    begun = true;
+    stats.begins++;
+}
+
+void SPIClass::end(void) {
+    sim::advance_us(5);
+    begun = false;
+    stats.ends++;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    sim::advance_ns(1000 + byteTime_ns(clockDivider));
+    stats.transfers++;
+    stats.bytes++;
+    record(SPITRACE_BYTE, 0, data);
+    if (flashSelected) return flashDevice(data);
+    return 0xc2; // satisfies the EPD COG ID, breakage and DC/DC checks
+}
+
+void SPIClass::transfer(void *buf, size_t count) {
+    sim::advance_ns(1000 + count * (byteTime_ns(clockDivider) + 100));
+    stats.transfers++;
+    stats.bytes += count;
+    uint8_t *p = (uint8_t *) buf;
+    for (size_t i = 0; i < count; i++) {
+        record(SPITRACE_BYTE, 0, p[i]);
+        p[i] = flashSelected ? flashDevice(p[i]) : 0xc2;
+    }
+}
+
+void SPIClass::record(uint8_t type, uint8_t pin, uint8_t value) {
+    if (stats.hash == 0) stats.hash = 2166136261UL;
+    stats.hash = (stats.hash ^ (type << 16 | pin << 8 | value)) * 16777619UL;
+    SimSpiEvent &e = trace[traceHead];
+    e.type = type;
+    e.pin = pin;
+    e.value = value;
+    traceHead = (traceHead + 1) % SIM_SPI_TRACE_SIZE;
+    if (traceCount < SIM_SPI_TRACE_SIZE) traceCount++;
+}
+
+uint32_t SPIClass::traceLength(void) const {
+    return traceCount;
+}
+
+SimSpiEvent SPIClass::traceEvent(uint32_t i) const {
+    uint32_t first = (traceHead + SIM_SPI_TRACE_SIZE - traceCount) % SIM_SPI_TRACE_SIZE;
+    return trace[(first + i) % SIM_SPI_TRACE_SIZE];
+}
+
+void SPIClass::chipSelect(uint8_t pin, uint8_t value) {
+    stats.csEdges++;
+    record(SPITRACE_CS, pin, value);
+
+    if (pin != SIM_FLASH_CS_PIN) return;
+
+    if (value == LOW) {
+        flashSelected = true;
+        flashCommand = 0;
+        flashBytes = 0;
+        flashAddress = 0;
+        return;
+    }
+
+    // chip select high completes program and erase commands
+    flashSelected = false;
+    if (flashCommand == FLASH_PP && flashBytes > 4 && flashWriteEnabled) {
+        stats.flashPagePrograms++;
+        flashWriteEnabled = false;
+        sim::advance_us(FLASH_PAGE_PROGRAM_US);
+    } else if (flashCommand == FLASH_SE && flashBytes >= 4 && flashWriteEnabled) {
+        uint32_t sector = (flashAddress % SIM_FLASH_SIZE) & ~(uint32_t) (FLASH_SECTOR - 1);
+        memset(&flash[sector], 0xff, FLASH_SECTOR);
+        stats.flashSectorErases++;
+        flashWriteEnabled = false;
+        sim::advance_us(FLASH_SECTOR_ERASE_US);
+    }
+}
+
+uint8_t SPIClass::flashDevice(uint8_t data) {
+    uint32_t n = flashBytes++;
+    if (n == 0) {
+        flashCommand = data;
+        if (data == FLASH_WREN) flashWriteEnabled = true;
+        if (data == FLASH_WRDI) flashWriteEnabled = false;
+        return 0xff;
+    }
+
+    switch (flashCommand) {
+    case FLASH_RDID:
+        return n == 1 ? 0xc2 : n == 2 ? 0x20 : 0x14;
+    case FLASH_RDSR:
+        return flashWriteEnabled ? FLASH_WEL : 0x00;
+    case FLASH_READ:
+    case FLASH_FAST_READ:
+    case FLASH_PP:
+    case FLASH_SE:
+        if (n <= 3) {
+            flashAddress = (flashAddress << 8) | data;
+            return 0xff;
+        }
+        if (flashCommand == FLASH_FAST_READ && n == 4) return 0xff; // dummy byte
+        if (flashCommand == FLASH_PP) {
+            // programming can only clear bits, and wraps within the page
+            uint32_t page = flashAddress & ~(uint32_t) (FLASH_PROGRAM_PAGE - 1);
+            uint32_t offset = (flashAddress + n - 4) % FLASH_PROGRAM_PAGE;
+            if (flashWriteEnabled) flash[(page + offset) % SIM_FLASH_SIZE] &= data;
+            return 0xff;
+        }
+        if (flashCommand == FLASH_SE) return 0xff;
+        stats.flashBytesRead++;
+        return flash[(flashAddress + n - (flashCommand == FLASH_FAST_READ ? 5 : 4)) % SIM_FLASH_SIZE];
+    default:
+        return 0xff;
+    }
+}
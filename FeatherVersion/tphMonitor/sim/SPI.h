@@ -0,0 +1,96 @@
+// SPI.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Stand-in for the SAMD SPI library.  Every byte and chip select edge is
+// counted, the most recent ones are kept in a trace ring, and an MX25V8005
+// model answers on the EPD_FLASH chip select pin.
+
+#ifndef SPI_H
+#define SPI_H
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x02
+#define SPI_MODE1 0x00
+#define SPI_MODE2 0x03
+#define SPI_MODE3 0x01
+
+#define SPI_CLOCK_DIV2   2
+#define SPI_CLOCK_DIV4   4
+#define SPI_CLOCK_DIV8   8
+#define SPI_CLOCK_DIV16  16
+#define SPI_CLOCK_DIV32  32
+#define SPI_CLOCK_DIV64  64
+#define SPI_CLOCK_DIV128 128
+
+#define SIM_SPI_TRACE_SIZE 4096
+#define SIM_FLASH_CS_PIN 11
+#define SIM_FLASH_SIZE (256UL * 4096UL)
+
+typedef struct {
+    uint8_t type; // SPITRACE_BYTE or SPITRACE_CS
+    uint8_t pin;  // chip select pin for SPITRACE_CS
+    uint8_t value; // byte sent, or new chip select level
+} SimSpiEvent;
+
+enum { SPITRACE_BYTE, SPITRACE_CS };
+
+typedef struct {
+    uint32_t begins;
+    uint32_t ends;
+    uint32_t transfers; // calls into transfer(), single byte or block
+    uint32_t bytes;
+    uint32_t csEdges;
+    uint32_t flashPagePrograms;
+    uint32_t flashSectorErases;
+    uint32_t flashBytesRead;
+    uint32_t hash; // FNV-1a over every byte and chip select edge, in order
+} SimSpiStats;
+
+class SPIClass {
+public:
+    SPIClass();
+    void begin(void);
+    void end(void);
+    void setBitOrder(uint8_t order) { bitOrder = order; }
+    void setDataMode(uint8_t mode) { dataMode = mode; }
+    void setClockDivider(uint8_t div) { clockDivider = div; }
+    uint8_t transfer(uint8_t data);
+    void transfer(void *buf, size_t count);
+
+    // simulation access
+    SimSpiStats stats;
+    void resetStats(void) { memset(&stats, 0, sizeof(stats)); }
+    bool isBegun(void) const { return begun; }
+    uint32_t traceLength(void) const; // events recorded (oldest may be dropped)
+    SimSpiEvent traceEvent(uint32_t i) const; // 0 = oldest still held
+    void clearTrace(void) { traceHead = traceCount = 0; }
+    void chipSelect(uint8_t pin, uint8_t value); // called by digitalWrite()
+    uint8_t *flashImage(void) { return flash; }
+
+private:
+    bool begun = false;
+    uint8_t bitOrder = MSBFIRST;
+    uint8_t dataMode = SPI_MODE0;
+    uint8_t clockDivider = SPI_CLOCK_DIV4;
+
+    SimSpiEvent trace[SIM_SPI_TRACE_SIZE];
+    uint32_t traceHead = 0;
+    uint32_t traceCount = 0;
+    void record(uint8_t type, uint8_t pin, uint8_t value);
+
+    // MX25V8005 model
+    uint8_t flash[SIM_FLASH_SIZE];
+    bool flashSelected = false;
+    bool flashWriteEnabled = false;
+    uint8_t flashCommand = 0;
+    uint32_t flashBytes = 0; // bytes seen since chip select went low
+    uint32_t flashAddress = 0;
+    uint8_t flashDevice(uint8_t data);
+};
+
+extern SPIClass SPI;
+
+#endif // SPI_H
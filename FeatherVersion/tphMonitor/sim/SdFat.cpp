@@ -0,0 +1,338 @@
+// SdFat.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// SD card in a local directory, with a sector write model
+
+#include <SdFat.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "HostSim.h"
+
+#define SD_MOUNT_US 50000
+#define SD_SECTOR_WRITE_US 1500
+#define SD_SECTOR_READ_US 500
+
+void (*SdFile::dateTime)(uint16_t *date, uint16_t *time) = NULL;
+
+static SimSdStats sdStatistics;
+
+SimSdStats &sim::sdStats() {
+    return sdStatistics;
+}
+
+const char *sim::sdRoot() {
+    const char *root = getenv("TPH_SIM_SD");
+    return root != NULL ? root : "sim_sd";
+}
+
+void sim::sdPath(char *out, size_t size, const char *path) {
+    while (*path == '/') path++;
+    snprintf(out, size, "%s/%s", sdRoot(), path);
+}
+
+static void writeSectors(uint32_t data, uint32_t meta) {
+    sdStatistics.dataSectorWrites += data;
+    sdStatistics.metaSectorWrites += meta;
+    sim::advance_us((uint64_t) (data + meta) * SD_SECTOR_WRITE_US);
+}
+
+bool SdFat::begin(uint8_t csPin, uint8_t divisor) {
+    (void) csPin; (void) divisor;
+    sim::advance_us(SD_MOUNT_US);
+    mkdir(sim::sdRoot(), 0755);
+    sdStatistics.mounts++;
+    return true;
+}
+
+bool SdFat::exists(const char *path) {
+    char full[256];
+    sim::sdPath(full, sizeof(full), path);
+    return access(full, F_OK) == 0;
+}
+
+bool SdFat::remove(const char *path) {
+    char full[256];
+    sim::sdPath(full, sizeof(full), path);
+    if (::remove(full) != 0) return false;
+    writeSectors(0, 2);
+    return true;
+}
+
+bool SdFat::rename(const char *oldPath, const char *newPath) {
+    char oldFull[256], newFull[256];
+    sim::sdPath(oldFull, sizeof(oldFull), oldPath);
+    sim::sdPath(newFull, sizeof(newFull), newPath);
+    if (access(newFull, F_OK) == 0) return false; // as FAT, never replaces
+    if (::rename(oldFull, newFull) != 0) return false;
+    writeSectors(0, 1); // the directory entry
+    return true;
+}
+
+void SdFat::errorPrint(void) {
+    Serial.println(F("SD errorCode: 0X0,0X0"));
+}
+
+// the card blocks handed out to contiguous files
+struct SimExtent {
+    char path[256];
+    uint32_t first;
+    uint32_t count;
+};
+static SimExtent extents[64];
+static int extentCount = 0;
+static uint32_t nextBlock = 0x2000; // past the FAT and root directory
+
+static SimExtent *findExtent(const char *path) {
+    for (int i = 0; i < extentCount; i++)
+        if (strcmp(extents[i].path, path) == 0) return &extents[i];
+    return NULL;
+}
+
+static SimExtent *findExtent(uint32_t block) {
+    for (int i = 0; i < extentCount; i++)
+        if (block >= extents[i].first && block < extents[i].first + extents[i].count) return &extents[i];
+    return NULL;
+}
+
+static SimExtent *addExtent(const char *path, uint32_t size) {
+    SimExtent *extent = findExtent(path);
+    if (extent == NULL) {
+        if (extentCount == (int) (sizeof(extents) / sizeof(extents[0]))) return NULL;
+        extent = &extents[extentCount++];
+        snprintf(extent->path, sizeof(extent->path), "%s", path);
+    }
+    extent->count = (size + SIM_SD_SECTOR - 1) / SIM_SD_SECTOR;
+    extent->first = nextBlock;
+    // keep files cluster aligned, like FAT does
+    nextBlock += (extent->count * SIM_SD_SECTOR + SIM_SD_CLUSTER - 1) / SIM_SD_CLUSTER
+        * (SIM_SD_CLUSTER / SIM_SD_SECTOR);
+    return extent;
+}
+
+bool SimCard::writeBlock(uint32_t block, const uint8_t *src) {
+    SimExtent *extent = findExtent(block);
+    if (extent == NULL) return false;
+    FILE *file = fopen(extent->path, "r+b");
+    if (file == NULL) return false;
+    fseek(file, (long) (block - extent->first) * SIM_SD_SECTOR, SEEK_SET);
+    bool ok = fwrite(src, 1, SIM_SD_SECTOR, file) == SIM_SD_SECTOR;
+    fclose(file);
+    sdStatistics.bytesWritten += SIM_SD_SECTOR;
+    sdStatistics.rawBlockWrites++;
+    writeSectors(1, 0);
+    return ok;
+}
+
+bool SimCard::readBlock(uint32_t block, uint8_t *dst) {
+    SimExtent *extent = findExtent(block);
+    if (extent == NULL) return false;
+    FILE *file = fopen(extent->path, "rb");
+    if (file == NULL) return false;
+    fseek(file, (long) (block - extent->first) * SIM_SD_SECTOR, SEEK_SET);
+    bool ok = fread(dst, 1, SIM_SD_SECTOR, file) == SIM_SD_SECTOR;
+    fclose(file);
+    sim::advance_us(SD_SECTOR_READ_US);
+    return ok;
+}
+
+bool SimFile::open(const char *path, bool write, bool create, bool append, bool truncate) {
+    char full[256];
+    sim::sdPath(full, sizeof(full), path);
+    close();
+    snprintf(this->path, sizeof(this->path), "%s", full);
+    bool existed = access(full, F_OK) == 0;
+    if (! existed && ! create) return false;
+    const char *mode = "rb";
+    if (write) mode = (truncate || ! existed) ? "w+b" : "r+b";
+    file = fopen(full, mode);
+    if (file == NULL) return false;
+    fseek(file, 0, SEEK_END);
+    length = synced = (uint32_t) ftell(file);
+    pos = 0;
+    cached = -1;
+    dirty = modified = false;
+    this->append = append;
+    if (! existed) writeSectors(0, 2); // directory entry and first FAT link
+    else if (truncate && length) modified = true;
+    return true;
+}
+
+void SimFile::close(void) {
+    if (file == NULL) return;
+    sync();
+    fclose(file);
+    file = NULL;
+}
+
+void SimFile::take(SimFile &other) {
+    close();
+    *this = other;
+    other.file = NULL;
+}
+
+size_t SimFile::write(const void *data, size_t count) {
+    if (file == NULL || count == 0) return 0;
+    if (append) pos = length;
+    fseek(file, pos, SEEK_SET);
+    if (fwrite(data, 1, count, file) != count) return 0;
+    sdStatistics.bytesWritten += count;
+    // each sector touched goes through the cache, and the previous one is
+    // written back as the cache moves on
+    for (int32_t sector = pos / SIM_SD_SECTOR;
+        sector <= (int32_t) ((pos + count - 1) / SIM_SD_SECTOR); sector++) {
+        if (sector != cached) {
+            if (dirty) writeSectors(1, 0);
+            cached = sector;
+        }
+        dirty = true;
+    }
+    pos += count;
+    if (pos > length) length = pos;
+    modified = true;
+    return count;
+}
+
+size_t SimFile::read(void *data, size_t count) {
+    if (file == NULL) return 0;
+    fseek(file, pos, SEEK_SET);
+    size_t got = fread(data, 1, count, file);
+    if (got) {
+        int32_t last = (pos + got - 1) / SIM_SD_SECTOR;
+        if (last != cached) {
+            if (dirty) writeSectors(1, 0);
+            cached = last;
+            dirty = false;
+        }
+    }
+    pos += got;
+    return got;
+}
+
+void SimFile::extend(uint32_t size) {
+    if (file == NULL || size <= length) return;
+    fflush(file);
+    if (ftruncate(fileno(file), size) != 0) return;
+    length = synced = size;
+}
+
+// files from createContiguous() have their blocks; files left on the card
+// by an earlier run are taken to be contiguous too
+bool SimFile::contiguousRange(uint32_t *first, uint32_t *last) {
+    if (file == NULL) return false;
+    SimExtent *extent = findExtent(path);
+    if (extent == NULL || extent->count * SIM_SD_SECTOR < length) extent = addExtent(path, length);
+    if (extent == NULL) return false;
+    *first = extent->first;
+    *last = extent->first + extent->count - 1;
+    return true;
+}
+
+bool SimFile::seek(uint32_t position) {
+    if (file == NULL || position > length) return false;
+    pos = position;
+    return true;
+}
+
+bool SimFile::sync(void) {
+    if (file == NULL) return false;
+    fflush(file);
+    if (dirty) {
+        writeSectors(1, 0);
+        dirty = false;
+    }
+    if (modified) {
+        uint32_t clusters = (length + SIM_SD_CLUSTER - 1) / SIM_SD_CLUSTER
+            - (synced + SIM_SD_CLUSTER - 1) / SIM_SD_CLUSTER;
+        // directory entry, and FAT if the chain grew
+        writeSectors(0, 1 + (clusters ? 1 : 0));
+        sdStatistics.syncs++;
+        synced = length;
+        modified = false;
+    }
+    return true;
+}
+
+bool SdFile::open(const char *path, int oflag) {
+    bool write = (oflag & O_ACCMODE) != O_RDONLY;
+    return sim.open(path, write, oflag & O_CREAT, oflag & O_APPEND, oflag & O_TRUNC);
+}
+
+// like SdFat, allocate one cluster chain without writing any data: the file
+// reads back as zeros here, where a real card returns whatever was there
+bool SdFile::createContiguous(const char *path, uint32_t size) {
+    if (! sim.open(path, true, true, false, true)) return false;
+    sim.extend(size);
+    uint32_t first, last;
+    sim.contiguousRange(&first, &last);
+    uint32_t clusters = (size + SIM_SD_CLUSTER - 1) / SIM_SD_CLUSTER;
+    // open() counted the directory entry and the first FAT sector, add the
+    // rest of the FAT sectors holding the chain (4 bytes a link)
+    uint32_t fatSectors = (clusters * 4 + SIM_SD_SECTOR - 1) / SIM_SD_SECTOR;
+    if (fatSectors > 1) writeSectors(0, fatSectors - 1);
+    return true;
+}
+
+ofstream &ofstream::operator=(ofstream &&other) {
+    file.take(other.file);
+    failed = other.failed;
+    return *this;
+}
+
+void ofstream::open(const char *path, ios::openmode mode) {
+    failed = ! file.open(path, true, true, true, ! (mode & ios::app));
+}
+
+void ofstream::close(void) {
+    file.close();
+}
+
+ofstream &ofstream::write(const char *data, size_t length) {
+    if (file.write(data, length) != length) failed = true;
+    return *this;
+}
+
+ofstream &ofstream::flush(void) {
+    file.sync();
+    return *this;
+}
+
+ofstream &ofstream::operator<<(int n) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", n);
+    return *this << buf;
+}
+
+ofstream &ofstream::operator<<(unsigned int n) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u", n);
+    return *this << buf;
+}
+
+ofstream &ofstream::operator<<(long n) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%ld", n);
+    return *this << buf;
+}
+
+ofstream &ofstream::operator<<(unsigned long n) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%lu", n);
+    return *this << buf;
+}
+
+// SdFat streams default to two decimal places
+ofstream &ofstream::operator<<(double n) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.2f", n);
+    return *this << buf;
+}
+
+ofstream &endl(ofstream &stream) {
+    return stream << '\n';
+}
+
+ofstream &flush(ofstream &stream) {
+    return stream.flush();
+}
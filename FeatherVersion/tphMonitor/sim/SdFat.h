@@ -0,0 +1,180 @@
+// SdFat.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Stand-in for the SdFat library.  Files are written to a local directory
+// (sim_sd/ unless TPH_SIM_SD is set) and every sector write the real card
+// would see is counted: data sectors as the 512 byte cache fills or is
+// flushed, plus a directory entry (and FAT sector for new clusters) per sync.
+// Files made with createContiguous() get a run of card blocks, which
+// card()->writeBlock() writes straight into, as one data sector each.
+
+#ifndef SDFAT_H
+#define SDFAT_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <fcntl.h>
+
+#define SPI_FULL_SPEED 2
+#define SPI_HALF_SPEED 4
+#define SPI_QUARTER_SPEED 8
+
+#define FAT_DATE(y, m, d) ((uint16_t) (((y) - 1980) << 9 | (m) << 5 | (d)))
+#define FAT_TIME(h, m, s) ((uint16_t) ((h) << 11 | (m) << 5 | (s) >> 1))
+
+#define SIM_SD_SECTOR 512
+#define SIM_SD_CLUSTER (8 * SIM_SD_SECTOR)
+
+typedef struct {
+    uint32_t mounts;
+    uint32_t syncs;
+    uint32_t dataSectorWrites;
+    uint32_t metaSectorWrites; // directory entry and FAT updates
+    uint32_t bytesWritten;
+    uint32_t rawBlockWrites; // card()->writeBlock(), also in dataSectorWrites
+} SimSdStats;
+
+namespace sim {
+    SimSdStats &sdStats();
+    const char *sdRoot();
+    void sdPath(char *out, size_t size, const char *path);
+}
+
+// raw block access, for contiguous files only
+class SimCard {
+public:
+    bool writeBlock(uint32_t block, const uint8_t *src);
+    bool readBlock(uint32_t block, uint8_t *dst);
+    void spiStop(void) {} // CS high, SPI transaction over
+};
+
+class SdFat {
+public:
+    SimCard *card(void) { return &simCard; }
+    bool begin(uint8_t csPin = SS, uint8_t divisor = SPI_FULL_SPEED);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *oldPath, const char *newPath);
+    void errorPrint(void);
+
+private:
+    SimCard simCard;
+};
+
+// an open file on the simulated card, with SdFat's single sector cache:
+// a data sector is written back when another sector is touched or on sync,
+// and a sync after any write also rewrites the directory entry (and the FAT
+// when the cluster chain grew)
+class SimFile {
+public:
+    bool open(const char *path, bool write, bool create, bool append, bool truncate);
+    void close(void);
+    bool isOpen(void) const { return file != NULL; }
+    size_t write(const void *data, size_t length);
+    size_t read(void *data, size_t length);
+    bool seek(uint32_t position);
+    bool sync(void);
+    void extend(uint32_t size); // preallocate, without writing data
+    bool contiguousRange(uint32_t *first, uint32_t *last);
+    uint32_t size(void) const { return length; }
+    uint32_t position(void) const { return pos; }
+    void take(SimFile &other);
+
+private:
+    FILE *file = NULL;
+    char path[256];
+    bool append = false;
+    uint32_t length = 0;
+    uint32_t pos = 0;
+    uint32_t synced = 0; // length at the last sync
+    int32_t cached = -1; // sector held in the cache
+    bool dirty = false; // cache holds unwritten data
+    bool modified = false; // written since the last sync
+};
+
+// SdFat open flags
+#ifndef O_READ
+#define O_READ O_RDONLY
+#define O_WRITE O_WRONLY
+#endif
+
+class SdFile {
+public:
+    SdFile() {}
+    SdFile(const SdFile &) = delete;
+    ~SdFile() { close(); }
+
+    static void dateTimeCallback(void (*callback)(uint16_t *date, uint16_t *time)) {
+        dateTime = callback;
+    }
+    static void (*dateTime)(uint16_t *date, uint16_t *time);
+
+    bool open(const char *path, int oflag = O_READ);
+    bool createContiguous(const char *path, uint32_t size);
+    bool contiguousRange(uint32_t *first, uint32_t *last) { return sim.contiguousRange(first, last); }
+    bool close(void) { sim.close(); return true; }
+    bool isOpen(void) const { return sim.isOpen(); }
+    int write(const void *data, size_t length) { return (int) sim.write(data, length); }
+    int read(void *data, size_t length) { return (int) sim.read(data, length); }
+    bool seekSet(uint32_t position) { return sim.seek(position); }
+    bool seekEnd(void) { return sim.seek(sim.size()); }
+    bool sync(void) { return sim.sync(); }
+    uint32_t fileSize(void) const { return sim.size(); }
+    uint32_t curPosition(void) const { return sim.position(); }
+
+private:
+    SimFile sim;
+};
+
+class ios {
+public:
+    typedef unsigned int openmode;
+    static const openmode app = 0x4;
+    static const openmode binary = 0x8;
+    static const openmode in = 0x10;
+    static const openmode out = 0x20;
+    static const openmode trunc = 0x40;
+};
+
+class ofstream {
+public:
+    ofstream() {}
+    ofstream(const char *path, ios::openmode mode = ios::out) { open(path, mode); }
+    ofstream(const ofstream &) = delete;
+    ofstream(ofstream &&other) { *this = static_cast<ofstream &&>(other); }
+    ofstream &operator=(ofstream &&other);
+    ~ofstream() { close(); }
+
+    void open(const char *path, ios::openmode mode = ios::out);
+    void close(void);
+    bool is_open(void) const { return file.isOpen(); }
+    bool good(void) const { return file.isOpen() && ! failed; }
+    bool operator!() const { return ! good(); }
+    explicit operator bool() const { return good(); }
+
+    ofstream &write(const char *data, size_t length);
+    ofstream &flush(void);
+    uint32_t tellp(void) const { return file.position(); }
+
+    ofstream &operator<<(const char *s) { return write(s, strlen(s)); }
+    ofstream &operator<<(const __FlashStringHelper *s) { return *this << (const char *) s; }
+    ofstream &operator<<(char c) { return write(&c, 1); }
+    ofstream &operator<<(int n);
+    ofstream &operator<<(unsigned int n);
+    ofstream &operator<<(long n);
+    ofstream &operator<<(unsigned long n);
+    ofstream &operator<<(double n);
+    ofstream &operator<<(float n) { return *this << (double) n; }
+    ofstream &operator<<(ofstream &(*manipulator)(ofstream &)) { return manipulator(*this); }
+
+private:
+    SimFile file;
+    bool failed = false;
+};
+
+ofstream &endl(ofstream &stream);
+ofstream &flush(ofstream &stream);
+
+#endif // SDFAT_H
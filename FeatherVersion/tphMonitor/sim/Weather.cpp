@@ -0,0 +1,209 @@
+// Weather.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Slowly varying weather for the BMP280 and Si7021 stand-ins, and a BMP280
+// register model on Wire that reports it as raw ADC readings
+
+#include <Adafruit_BMP280.h>
+#include <SI7021.h>
+#include <RTClib.h>
+#include <Wire.h>
+#include "HostSim.h"
+
+// register pointer write plus a 3 byte read, as Adafruit_BMP280::read24()
+#define BMP280_READ24_US 600
+// Si7021 conversion times (hold master mode), datasheet maximums
+#define SI7021_TEMP_US 10800
+#define SI7021_RH_US 12000
+
+static double seconds() {
+    return sim::rtcEpoch() + sim::now_us() / 1e6;
+}
+
+float sim::weatherTemperature_C() {
+    return 20. + 4. * sin(2. * M_PI * fmod(seconds(), 86400.) / 86400.);
+}
+
+float sim::weatherPressure_Pa() {
+    return 101325. + 900. * sin(2. * M_PI * seconds() / (4.3 * 86400.));
+}
+
+float sim::weatherHumidity_percent() {
+    return 45. + 15. * sin(2. * M_PI * seconds() / (1.7 * 86400.));
+}
+
+// BMP280 with the datasheet's example calibration (section 3.12).  Forced
+// mode conversions take their typical time; the readings are the weather
+// run backwards through the datasheet compensation.
+#define BMP280_REGISTERS 0x100
+#define BMP280_CHIP_ID 0x58
+
+static const uint16_t bmp280Calibration[12] = {
+    27504, 26435, (uint16_t) -1000, 36477, (uint16_t) -10685, 3024,
+    2855, 140, (uint16_t) -7, 15500, (uint16_t) -14600, 6000
+};
+
+static int32_t bmp280TFine(int32_t adcT) {
+    int32_t t1 = bmp280Calibration[0];
+    int32_t t2 = (int16_t) bmp280Calibration[1];
+    int32_t t3 = (int16_t) bmp280Calibration[2];
+    int32_t var1 = (((adcT >> 3) - (t1 << 1)) * t2) >> 11;
+    int32_t var2 = (((((adcT >> 4) - t1) * ((adcT >> 4) - t1)) >> 12) * t3) >> 14;
+    return var1 + var2;
+}
+
+// Q24.8 Pa
+static int64_t bmp280Pressure(int32_t adcP, int32_t tFine) {
+    const uint16_t *cal = bmp280Calibration;
+    int64_t var1 = (int64_t) tFine - 128000;
+    int64_t var2 = var1 * var1 * (int16_t) cal[8];
+    var2 = var2 + ((var1 * (int16_t) cal[7]) << 17);
+    var2 = var2 + ((int64_t) (int16_t) cal[6] << 35);
+    var1 = ((var1 * var1 * (int16_t) cal[5]) >> 8) + ((var1 * (int16_t) cal[4]) << 12);
+    var1 = ((((int64_t) 1 << 47) + var1) * cal[3]) >> 33;
+    int64_t p = 1048576 - adcP;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = ((int64_t) (int16_t) cal[11] * (p >> 13) * (p >> 13)) >> 25;
+    var2 = ((int64_t) (int16_t) cal[10] * p) >> 19;
+    return ((p + var1 + var2) >> 8) + ((int64_t) (int16_t) cal[9] << 4);
+}
+
+class SimBmp280 : public SimI2cDevice {
+public:
+    SimBmp280() {
+        memset(regs, 0, sizeof(regs));
+        regs[0xD0] = BMP280_CHIP_ID;
+        for (int i = 0; i < 12; i++) {
+            regs[0x88 + 2 * i] = bmp280Calibration[i] & 0xff;
+            regs[0x89 + 2 * i] = bmp280Calibration[i] >> 8;
+        }
+        regs[0xF7] = 0x80; // reset values
+        regs[0xFA] = 0x80;
+    }
+
+    void i2cWrite(const uint8_t *data, uint8_t length) {
+        if (! length) return;
+        pointer = data[0];
+        for (uint8_t i = 1; i < length; i++) {
+            regs[pointer] = data[i];
+            if (pointer == 0xF4 && (data[i] & 0x03) == 0x01) {
+                doneAt_us = sim::now_us() + conversion_us(data[i]);
+                pending = true;
+            }
+            pointer++;
+        }
+    }
+
+    void i2cRead(uint8_t *data, uint8_t length) {
+        uint64_t now = sim::now_us();
+        if (pending && now >= doneAt_us) {
+            latch();
+            pending = false;
+            regs[0xF4] &= ~0x03; // back to sleep
+        }
+        if ((regs[0xF4] & 0x03) == 0x03) latch(); // normal mode
+        regs[0xF3] = pending ? 0x08 : 0;
+        for (uint8_t i = 0; i < length; i++) data[i] = regs[pointer++];
+    }
+
+private:
+    uint8_t regs[BMP280_REGISTERS];
+    uint8_t pointer = 0;
+    uint64_t doneAt_us = 0;
+    bool pending = false;
+
+    // datasheet typical: 1 ms + 2 ms per temperature and pressure sample,
+    // + 0.5 ms if measuring pressure
+    static uint64_t conversion_us(uint8_t ctrlMeas) {
+        static const uint8_t samples[] = { 0, 1, 2, 4, 8, 16, 16, 16 };
+        uint8_t t = samples[ctrlMeas >> 5], p = samples[(ctrlMeas >> 2) & 0x07];
+        return 1000 + 2000 * t + 2000 * p + (p ? 500 : 0);
+    }
+
+    void latch() {
+        // both compensations increase or decrease monotonically in the
+        // reading, so search the 20 bit range
+        int32_t centiC = (int32_t) lround((sim::weatherTemperature_C() + 0.6) * 100.);
+        int32_t lo = 0, hi = (1 << 20) - 1;
+        while (lo < hi) {
+            int32_t mid = (lo + hi) / 2;
+            if (((bmp280TFine(mid) * 5 + 128) >> 8) < centiC) lo = mid + 1;
+            else hi = mid;
+        }
+        int32_t adcT = lo;
+        int32_t tFine = bmp280TFine(adcT);
+        int64_t pressure = (int64_t) lround(sim::weatherPressure_Pa() * 256.);
+        lo = 0, hi = (1 << 20) - 1;
+        while (lo < hi) {
+            int32_t mid = (lo + hi) / 2;
+            if (bmp280Pressure(mid, tFine) > pressure) lo = mid + 1;
+            else hi = mid;
+        }
+        int32_t adcP = lo;
+        regs[0xF7] = adcP >> 12;
+        regs[0xF8] = adcP >> 4;
+        regs[0xF9] = (adcP & 0x0f) << 4;
+        regs[0xFA] = adcT >> 12;
+        regs[0xFB] = adcT >> 4;
+        regs[0xFC] = (adcT & 0x0f) << 4;
+    }
+};
+
+static SimBmp280 bmp280;
+
+bool Adafruit_BMP280::begin(uint8_t addr) {
+    static bool attached = false;
+    if (! attached) Wire.attach(addr, &bmp280);
+    attached = true;
+    sim::advance_us(BMP280_READ24_US * 8); // chip id and calibration reads
+    // normal mode, temperature x1, pressure x16
+    static const uint8_t control[] = { 0xF4, 0x3F };
+    bmp280.i2cWrite(control, sizeof(control));
+    return true;
+}
+
+float Adafruit_BMP280::readTemperature(void) {
+    sim::advance_us(BMP280_READ24_US);
+    return sim::weatherTemperature_C() + 0.6; // self heating on the board
+}
+
+float Adafruit_BMP280::readPressure(void) {
+    readTemperature(); // must be done first to get t_fine
+    sim::advance_us(BMP280_READ24_US);
+    return sim::weatherPressure_Pa();
+}
+
+float Adafruit_BMP280::readAltitude(float seaLevelhPa) {
+    float pressure = readPressure() / 100.;
+    return 44330 * (1.0 - pow(pressure / seaLevelhPa, 0.1903));
+}
+
+int SI7021::getCelsiusHundredths(void) {
+    sim::advance_us(SI7021_TEMP_US);
+    return (int) lround(sim::weatherTemperature_C() * 100.);
+}
+
+int SI7021::getFahrenheitHundredths(void) {
+    int c = getCelsiusHundredths();
+    return (1.8 * c) + 3200;
+}
+
+unsigned int SI7021::getHumidityBasisPoints(void) {
+    sim::advance_us(SI7021_RH_US);
+    return (unsigned int) lround(sim::weatherHumidity_percent() * 100.);
+}
+
+unsigned int SI7021::getHumidityPercent(void) {
+    return getHumidityBasisPoints() / 100;
+}
+
+struct si7021_env SI7021::getHumidityAndTemperature(void) {
+    si7021_env ret;
+    // temperature comes from the humidity conversion, no second measurement
+    ret.humidityBasisPoints = getHumidityBasisPoints();
+    ret.celsiusHundredths = (int) lround(sim::weatherTemperature_C() * 100.);
+    ret.fahrenheitHundredths = (1.8 * ret.celsiusHundredths) + 3200;
+    return ret;
+}
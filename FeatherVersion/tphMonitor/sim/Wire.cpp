@@ -0,0 +1,64 @@
+// Wire.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// I2C bus at 100 kHz: 9 bit times per byte plus start/stop
+
+#include <Wire.h>
+#include "HostSim.h"
+
+#define I2C_BYTE_US 90
+#define I2C_FRAME_US 20
+
+TwoWire Wire;
+
+void TwoWire::attach(uint8_t address, SimI2cDevice *device) {
+    if (deviceCount < SIM_WIRE_DEVICES) {
+        addresses[deviceCount] = address;
+        devices[deviceCount++] = device;
+    }
+}
+
+SimI2cDevice *TwoWire::find(uint8_t address) {
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (addresses[i] == address) return devices[i];
+    }
+    return NULL;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    txAddress = address;
+    txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (txLength >= SIM_WIRE_BUFFER) return 0;
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void) sendStop;
+    stats.transactions++;
+    stats.bytes += txLength + 1;
+    sim::advance_us(I2C_FRAME_US + (txLength + 1) * I2C_BYTE_US);
+    SimI2cDevice *device = find(txAddress);
+    if (device == NULL) return 2; // address NACK
+    device->i2cWrite(txBuffer, txLength);
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop) {
+    (void) sendStop;
+    if (quantity > SIM_WIRE_BUFFER) quantity = SIM_WIRE_BUFFER;
+    stats.transactions++;
+    stats.bytes += quantity + 1;
+    sim::advance_us(I2C_FRAME_US + (quantity + 1) * I2C_BYTE_US);
+    rxIndex = rxLength = 0;
+    SimI2cDevice *device = find(address);
+    if (device == NULL) return 0;
+    device->i2cRead(rxBuffer, quantity);
+    rxLength = quantity;
+    return quantity;
+}
@@ -0,0 +1,61 @@
+// Wire.h
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Stand-in for the Wire (I2C) library.  Devices register a register-file
+// handler by address; every transaction costs virtual bus time.
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <Arduino.h>
+
+#define SIM_WIRE_BUFFER 32
+#define SIM_WIRE_DEVICES 4
+
+// handler for one device: write bytes (register pointer first), or read bytes
+// starting at the current register pointer
+class SimI2cDevice {
+public:
+    virtual ~SimI2cDevice() {}
+    virtual void i2cWrite(const uint8_t *data, uint8_t length) = 0;
+    virtual void i2cRead(uint8_t *data, uint8_t length) = 0;
+};
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t bytes;
+} SimWireStats;
+
+class TwoWire {
+public:
+    void begin(void) {}
+    void setClock(uint32_t clock) { (void) clock; }
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+    size_t write(uint8_t data);
+    int available(void) { return rxLength - rxIndex; }
+    int read(void) { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+
+    // simulation access
+    void attach(uint8_t address, SimI2cDevice *device);
+    SimWireStats stats;
+
+private:
+    SimI2cDevice *find(uint8_t address);
+    uint8_t addresses[SIM_WIRE_DEVICES];
+    SimI2cDevice *devices[SIM_WIRE_DEVICES];
+    uint8_t deviceCount = 0;
+    uint8_t txAddress = 0;
+    uint8_t txBuffer[SIM_WIRE_BUFFER];
+    uint8_t txLength = 0;
+    uint8_t rxBuffer[SIM_WIRE_BUFFER];
+    uint8_t rxLength = 0;
+    uint8_t rxIndex = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // WIRE_H
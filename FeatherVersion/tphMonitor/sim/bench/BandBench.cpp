@@ -0,0 +1,121 @@
+// BandBench.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Refresh time against band size for EPD_GFX's banded rendering: the frame
+// displayDataPoint() would draw, sent with displayBands() in bands of 8 lines
+// up to the whole panel, and a check that every band size puts the same
+// frame in EPD_FLASH.  The virtual clock doesn't see host computation, so
+// each draw() advances it by its host time times a slowdown standing in for
+// the Feather's 48 MHz Cortex-M0+.
+//
+//     platformio run -e bandbench && .pio/build/bandbench/program [refreshes [slowdown]]
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <time.h>
+#include "HostSim.h"
+
+#define FEATHER 1
+#define EPD_ENABLE_EXTRA_SRAM 1
+#define SCREEN_SIZE 200
+#define EPD_GFX_ROTATION 2
+#define EPD_GFX_FLASH_IMAGE 0
+#define EPD_GFX_BAND_LINES 96 // room for every band size tried
+
+#include <EPD_FLASH.h>
+#include <EPD_V231_G2.h>
+#include <EPD_PANELS.h>
+#include <EPD_PINOUT.h>
+#include <EPD_GFX.h>
+
+#define SLOWDOWN 30 // host against the Feather, roughly
+
+static EPD_Class epd(EPD_SIZE, Pin_PANEL_ON, Pin_BORDER, Pin_DISCHARGE, Pin_RESET,
+    Pin_BUSY, Pin_EPD_CS);
+static EPD_GFX gfx(epd);
+
+static double slowdown = SLOWDOWN;
+static unsigned long draws;
+static double drawSeconds;
+
+static double seconds() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Papirus::addVertScale()'s drawing, as in GfxBench.cpp
+static void scale(EPD_GFX &gfx, int x, int barHeight, int minorPx, int majorPx) {
+    const int bottom = EPD_PIXEL_HEIGHT - 5, top = 25, heightPx = bottom - top;
+    gfx.fillRect(x + 1, bottom - barHeight, 4, barHeight, EPD_GFX::BLACK);
+    gfx.drawLine(x, bottom, x, bottom - heightPx, EPD_GFX::BLACK);
+    for (int tick = 0; tick <= heightPx; tick += minorPx) {
+        gfx.drawLine(x - (tick % majorPx ? 2 : 4), bottom - tick, x, bottom - tick, EPD_GFX::BLACK);
+    }
+    gfx.blitText(x - 50, bottom - 7, " 62.125");
+    gfx.blitText(x - 50, (top + bottom) / 2, " 70.500");
+    gfx.blitText(x - 50, top + 7, " 74.875");
+}
+
+// an EPD_GFX_draw: the whole frame, whichever band is being rendered
+static void compose(EPD_GFX &gfx) {
+    double start = seconds();
+    gfx.drawRect(0, 0, gfx.width(), gfx.height(), EPD_GFX::BLACK);
+    gfx.blitText(5, 3, "2017.02.04, 12:30+00 L    +4.12V");
+    gfx.drawLine(0, 11, 200, 11, EPD_GFX::BLACK);
+    gfx.blitText(3, 14, " Temp [F]");
+    gfx.blitText(68, 14, "Pres [hPa]");
+    gfx.blitText(134, 14, "  Hum [%]");
+    scale(gfx, 60, 37, 2, 4);
+    scale(gfx, 126, 41, 2, 8);
+    scale(gfx, 192, 23, 3, 6);
+    double elapsed = seconds() - start;
+
+    draws++;
+    drawSeconds += elapsed;
+    sim::advance_ns(elapsed * slowdown * 1e9);
+}
+
+int main(int argc, char **argv) {
+    unsigned long refreshes = 3;
+    if (argc > 1) refreshes = strtoul(argv[1], NULL, 10);
+    if (refreshes == 0) refreshes = 1;
+    if (argc > 2) slowdown = strtod(argv[2], NULL);
+
+    EPD_FLASH.begin(Pin_EPD_FLASH_CS);
+    gfx.begin(20);
+
+    const int16_t bands[] = { 96, 48, 32, 24, 16, 12, 8 };
+    static uint8_t frame[EPD_PIXEL_WIDTH * EPD_PIXEL_HEIGHT / 8];
+    bool same = true;
+
+    printf("%lu refreshes per band size, draw() slowed down %.0fx\n", refreshes, slowdown);
+    printf("%6s %8s %8s %12s %12s %16s\n",
+        "lines", "buffer", "draws", "draw ms", "refresh ms", "repeats inv/norm");
+    for (unsigned int i = 0; i < sizeof(bands) / sizeof(bands[0]); i++) {
+        draws = 0;
+        drawSeconds = 0;
+        uint64_t start = sim::now_us();
+        for (unsigned long r = 0; r < refreshes; r++) {
+            gfx.displayBands(20, compose, bands[i]);
+        }
+        uint64_t elapsed = sim::now_us() - start;
+
+        printf("%6d %7dB %8.1f %12.3f %12.1f %11u/%u\n",
+            bands[i], bands[i] * EPD_PIXEL_WIDTH / 8, (double) draws / refreshes,
+            drawSeconds * slowdown * 1e3 / refreshes, elapsed / 1e3 / refreshes,
+            epd.repeats(EPD_inverse), epd.repeats(EPD_normal));
+
+        // the whole panel in one band is the reference
+        if (0 == i) memcpy(frame, SPI.flashImage(), sizeof(frame));
+        else if (memcmp(frame, SPI.flashImage(), sizeof(frame))) {
+            printf("%d line bands put a different frame in EPD_FLASH\n", bands[i]);
+            same = false;
+        }
+    }
+    if (!same) return 1;
+    printf("same frame in EPD_FLASH for every band size\n");
+    return 0;
+}
@@ -0,0 +1,129 @@
+// GfxBench.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Host time to compose one frame like displayDataPoint() does, through the
+// generic Adafruit_GFX primitives (every rectangle and line one drawPixel()
+// at a time), EPD_GFX's span fills, and the span fills with text from
+// blitText(), and a check that all three produce the same frame on the panel.
+//
+//     platformio run -e gfxbench && .pio/build/gfxbench/program [frames]
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <time.h>
+#include "HostSim.h"
+#include "Papirus.hpp"
+
+// EPD_GFX with the span fills taken away again
+class PixelGfx : public EPD_GFX {
+public:
+    PixelGfx(EPD_Class &epd) : EPD_GFX(epd) {}
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t colour) {
+        Adafruit_GFX::drawFastVLine(x, y, h, colour);
+    }
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t colour) {
+        Adafruit_GFX::drawFastHLine(x, y, w, colour);
+    }
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t colour) {
+        Adafruit_GFX::fillRect(x, y, w, h, colour);
+    }
+    void fillScreen(uint16_t colour) {
+        Adafruit_GFX::fillScreen(colour);
+    }
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t colour) {
+        Adafruit_GFX::drawLine(x0, y0, x1, y1, colour);
+    }
+};
+
+static EPD_Class epd(EPD_SIZE, Pin_PANEL_ON, Pin_BORDER, Pin_DISCHARGE, Pin_RESET,
+    Pin_BUSY, Pin_EPD_CS);
+
+static bool blit = false;
+
+static void text(EPD_GFX &gfx, int x, int y, const char *s) {
+    if (blit) {
+        gfx.blitText(x, y, s);
+        return;
+    }
+    gfx.setCursor(x, y);
+    gfx.setTextColor(EPD_GFX::BLACK, EPD_GFX::WHITE);
+    gfx.setTextSize(1);
+    gfx.setTextWrap(false);
+    gfx.print(s);
+}
+
+// Papirus::addVertScale()'s drawing, for a bar height and tick spacing
+static void scale(EPD_GFX &gfx, int x, int barHeight, int minorPx, int majorPx) {
+    const int bottom = EPD_PIXEL_HEIGHT - 5, top = 25, heightPx = bottom - top;
+    gfx.fillRect(x + 1, bottom - heightPx, 4, heightPx, EPD_GFX::WHITE);
+    gfx.fillRect(x + 1, bottom - barHeight, 4, barHeight, EPD_GFX::BLACK);
+    gfx.drawLine(x, bottom, x, bottom - heightPx, EPD_GFX::BLACK);
+    for (int tick = 0; tick <= heightPx; tick += minorPx) {
+        gfx.drawLine(x - (tick % majorPx ? 2 : 4), bottom - tick, x, bottom - tick, EPD_GFX::BLACK);
+    }
+    text(gfx, x - 50, bottom - 7, " 62.125");
+    text(gfx, x - 50, (top + bottom) / 2, " 70.500");
+    text(gfx, x - 50, top + 7, " 74.875");
+}
+
+static void compose(EPD_GFX &gfx, int frame) {
+    gfx.fillScreen(EPD_GFX::WHITE);
+    gfx.drawRect(0, 0, gfx.width(), gfx.height(), EPD_GFX::BLACK);
+    text(gfx, 5, 3, "2017.02.04, 12:30+00 L    +4.12V");
+    gfx.drawLine(0, 11, 200, 11, EPD_GFX::BLACK);
+    text(gfx, 3, 14, " Temp [F]");
+    text(gfx, 68, 14, "Pres [hPa]");
+    text(gfx, 134, 14, "  Hum [%]");
+    scale(gfx, 60, 20 + frame % 40, 2, 4);
+    scale(gfx, 126, 30 + frame % 20, 2, 8);
+    scale(gfx, 192, 10 + frame % 50, 3, 6);
+}
+
+static double seconds() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// host microseconds per frame, and the panel stream of the last one
+static double bench(EPD_GFX &gfx, unsigned long frames, uint32_t *stream) {
+    gfx.begin(20);
+    double start = seconds();
+    for (unsigned long i = 0; i < frames; i++) {
+        compose(gfx, i);
+    }
+    double us = (seconds() - start) * 1e6 / frames;
+    SPI.resetStats();
+    gfx.display(20);
+    *stream = SPI.stats.hash;
+    return us;
+}
+
+int main(int argc, char **argv) {
+    unsigned long frames = 10000;
+    if (argc > 1) frames = strtoul(argv[1], NULL, 10);
+    if (frames == 0) frames = 1;
+
+    PixelGfx pixels(epd);
+    EPD_GFX spans(epd);
+    EPD_GFX blits(epd);
+    uint32_t pixelStream, spanStream, blitStream;
+    double pixelUs = bench(pixels, frames, &pixelStream);
+    double spanUs = bench(spans, frames, &spanStream);
+    blit = true;
+    double blitUs = bench(blits, frames, &blitStream);
+
+    printf("%lu frames, rotation %d\n", frames, spans.getRotation());
+    printf("%-24s %8.2f us/frame\n", "per pixel", pixelUs);
+    printf("%-24s %8.2f us/frame (%.1fx)\n", "span fills", spanUs, pixelUs / spanUs);
+    printf("%-24s %8.2f us/frame (%.1fx)\n", "span fills, blitText()", blitUs, pixelUs / blitUs);
+    if (pixelStream != spanStream || pixelStream != blitStream) {
+        printf("frames differ: stream %08x against %08x and %08x\n",
+            pixelStream, spanStream, blitStream);
+        return 1;
+    }
+    printf("same frame on the panel, stream %08x\n", spanStream);
+    return 0;
+}
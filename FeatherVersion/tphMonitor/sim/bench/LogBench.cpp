@@ -0,0 +1,60 @@
+// LogBench.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// SD sector writes per day for the binary log: writing every record as it
+// comes (the old flush-per-record behaviour) against holding records in the
+// sector image for up to an hour, or until the sector is full.  Runs LogFile
+// alone on the simulated card, one record per LOGINTERVAL.
+//
+//     platformio run -e logbench && .pio/build/logbench/program [days]
+
+#include <Arduino.h>
+#include <SdFat.h>
+#include <sys/stat.h>
+#include "HostSim.h"
+#include "Sensors.hpp"
+#include "LogFile.hpp"
+#include "DataPoint.hpp"
+
+#define LOGINTERVAL 600 // seconds, as in main.cpp
+
+static void bench(Sensors *sensors, const char *label, uint32_t maxAge, unsigned long days) {
+    char root[64];
+    mkdir("sim_sd", 0755);
+    snprintf(root, sizeof(root), "sim_sd/logbench-%lu", (unsigned long) maxAge);
+    setenv("TPH_SIM_SD", root, 1);
+    sim::sdStats() = SimSdStats();
+
+    LogFile *logFile = LogFile::initSdLogFile(sensors, NULL, true, LogFile::BINARY, LOGINTERVAL);
+    logFile->setMaxAge(maxAge);
+    // leave out creating the file, only count the appends
+    const SimSdStats start = sim::sdStats();
+
+    unsigned long records = days * 86400 / LOGINTERVAL;
+    for (unsigned long i = 0; i < records; i++) {
+        sim::advance_us((uint64_t) LOGINTERVAL * 1000000);
+        DataPoint dp(sensors);
+        logFile->append(dp.record());
+    }
+
+    const SimSdStats &sd = sim::sdStats();
+    uint32_t data = sd.dataSectorWrites - start.dataSectorWrites;
+    uint32_t meta = sd.metaSectorWrites - start.metaSectorWrites;
+    printf("%-24s %8.1f data + %6.1f metadata = %8.1f sector writes/day\n",
+        label, (double) data / days, (double) meta / days, (double) (data + meta) / days);
+}
+
+int main(int argc, char **argv) {
+    unsigned long days = 30;
+    if (argc > 1) days = strtoul(argv[1], NULL, 10);
+    if (days == 0) days = 1;
+
+    Sensors *sensors = new Sensors();
+    printf("binary log, %lu days of %d s records\n", days, LOGINTERVAL);
+    bench(sensors, "every record", 0, days);
+    bench(sensors, "max age 1 h", 3600, days);
+    bench(sensors, "full sectors only", 0xffffffff, days);
+    return 0;
+}
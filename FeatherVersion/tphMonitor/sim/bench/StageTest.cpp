@@ -0,0 +1,122 @@
+// StageTest.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// Every entry of EPD_V231_G2's compile-time stage tables, all 256 data bytes
+// in each of the 4 stages, against the per-pixel formulas even_pixels(),
+// odd_pixels() and all_pixels() used before the tables.
+//
+//     platformio run -e stagetest && .pio/build/stagetest/program
+
+#include <stdio.h>
+
+// the tables are static to the driver, so it is built into this program
+// (the env ignores the library)
+#include "../../lib/EPD_V231_G2/EPD_V231_G2.cpp"
+
+static const EPD_stage stages[4] = {
+    EPD_compensate, EPD_white, EPD_inverse, EPD_normal
+};
+static const char *stageNames[4] = {
+    "compensate", "white", "inverse", "normal"
+};
+
+// the formulas as they were, a byte at a time
+
+static uint8_t evenFormula(EPD_stage stage, uint8_t data) {
+    uint8_t pixels = data & 0xaa;
+    switch (stage) {
+    case EPD_compensate:  // B -> W, W -> B (Current Image)
+        pixels = 0xaa | ((pixels ^ 0xaa) >> 1);
+        break;
+    case EPD_white:       // B -> N, W -> W (Current Image)
+        pixels = 0x55 + ((pixels ^ 0xaa) >> 1);
+        break;
+    case EPD_inverse:     // B -> N, W -> B (New Image)
+        pixels = 0x55 | (pixels ^ 0xaa);
+        break;
+    case EPD_normal:       // B -> B, W -> W (New Image)
+        pixels = 0xaa | (pixels >> 1);
+        break;
+    }
+    uint8_t p1 = (pixels >> 6) & 0x03;
+    uint8_t p2 = (pixels >> 4) & 0x03;
+    uint8_t p3 = (pixels >> 2) & 0x03;
+    uint8_t p4 = (pixels >> 0) & 0x03;
+    return (p1 << 0) | (p2 << 2) | (p3 << 4) | (p4 << 6);
+}
+
+static uint8_t oddFormula(EPD_stage stage, uint8_t data) {
+    uint8_t pixels = data & 0x55;
+    switch (stage) {
+    case EPD_compensate:  // B -> W, W -> B (Current Image)
+        pixels = 0xaa | (pixels ^ 0x55);
+        break;
+    case EPD_white:       // B -> N, W -> W (Current Image)
+        pixels = 0x55 + (pixels ^ 0x55);
+        break;
+    case EPD_inverse:     // B -> N, W -> B (New Image)
+        pixels = 0x55 | ((pixels ^ 0x55) << 1);
+        break;
+    case EPD_normal:       // B -> B, W -> W (New Image)
+        pixels = 0xaa | pixels;
+        break;
+    }
+    return pixels;
+}
+
+static uint16_t allFormula(EPD_stage stage, uint8_t data) {
+    uint16_t pixels = data;
+    pixels = (pixels | (pixels << 4)) & 0x0f0f;
+    pixels = (pixels | (pixels << 2)) & 0x3333;
+    pixels = (pixels | (pixels << 1)) & 0x5555;
+    switch (stage) {
+    case EPD_compensate:  // B -> W, W -> B (Current Image)
+        pixels = 0xaaaa | (pixels ^ 0x5555);
+        break;
+    case EPD_white:       // B -> N, W -> W (Current Image)
+        pixels = 0x5555 + (pixels ^ 0x5555);
+        break;
+    case EPD_inverse:     // B -> N, W -> B (New Image)
+        pixels = 0x5555 | ((pixels ^ 0x5555) << 1);
+        break;
+    case EPD_normal:       // B -> B, W -> W (New Image)
+        pixels = 0xaaaa | pixels;
+        break;
+    }
+    return pixels;
+}
+
+int main() {
+    unsigned long failures = 0;
+    for (int s = 0; s < 4; ++s) {
+        EPD_stage stage = stages[s];
+        for (int data = 0; data < 256; ++data) {
+            uint8_t even = evenFormula(stage, data);
+            uint8_t odd = oddFormula(stage, data);
+            uint16_t all = allFormula(stage, data);
+            if (even_table[stage][data] != even) {
+                printf("even %s %02x: table %02x, formula %02x\n", stageNames[s], data,
+                    even_table[stage][data], even);
+                ++failures;
+            }
+            if (odd_table[stage][data] != odd) {
+                printf("odd  %s %02x: table %02x, formula %02x\n", stageNames[s], data,
+                    odd_table[stage][data], odd);
+                ++failures;
+            }
+            if (all_table[stage][data] != all) {
+                printf("all  %s %02x: table %04x, formula %04x\n", stageNames[s], data,
+                    all_table[stage][data], all);
+                ++failures;
+            }
+        }
+    }
+    if (0 != failures) {
+        printf("%lu of %d table entries differ\n", failures, 3 * 4 * 256);
+        return 1;
+    }
+    printf("all %d table entries match\n", 3 * 4 * 256);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// TimingLogTest.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor host simulation
+// The timing summary in a binary log: LogFile with TIMING, batched as in
+// main.cpp, on the simulated card for a number of days, then the file read
+// back slot by slot.  Fails unless every record and a summary for each batch
+// that had one due are there, and the card came up once per batch and no
+// more.
+//
+//     platformio run -e timinglogtest && .pio/build/timinglogtest/program [days]
+
+#define TIMING
+#include <Arduino.h>
+#include <SPI.h>
+#include <SdFat.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include "HostSim.h"
+#include "Sensors.hpp"
+#include "LogFile.hpp"
+#include "DataPoint.hpp"
+#include "Timing.hpp"
+
+#define LOGINTERVAL 600 // seconds, as in main.cpp
+#define LOGBATCH 31
+
+// add up records and timing summary lines in a file, false if it can't be
+// read
+static bool readLog(const char *path, unsigned long &records, unsigned long &summaries) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return false;
+    }
+
+    LogFileHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1
+        || memcmp(header.magic, LOGFILE_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s: not a binary log\n", path);
+        fclose(in);
+        return false;
+    }
+
+    for (uint32_t slot = 1; ; slot++) {
+        uint8_t image[LOGFILE_SLOT_SIZE];
+        if (fseek(in, (long) slot * LOGFILE_SLOT_SIZE, SEEK_SET) != 0
+            || fread(image, sizeof(image), 1, in) != 1) break;
+
+        size_t used = 0;
+        while (used + sizeof(LogBlockHeader) <= sizeof(image)) {
+            LogBlockHeader block;
+            memcpy(&block, image + used, sizeof(block));
+            size_t length = block.count;
+            if (block.marker == LOGBLOCK_RECORDS) length *= sizeof(LogRecord);
+            else if (block.marker != LOGBLOCK_COMMENT) break;
+            const uint8_t *payload = image + used + sizeof(block);
+            if (used + sizeof(block) + length > sizeof(image)
+                || logBlockCrc(block.count, payload, length,
+                    logSlotSeed(header.created, slot)) != block.crc) break;
+
+            if (block.marker == LOGBLOCK_RECORDS) records += block.count;
+            else if (! memcmp(payload, "# timing", 8)) summaries++;
+            used += sizeof(block) + length;
+        }
+        if (! used) break;
+    }
+
+    fclose(in);
+    remove(path); // so the next run starts a new log rather than resuming it
+    return true;
+}
+
+// every binary log on the card, as a long run carries on in new files
+static bool readLogs(unsigned long &records, unsigned long &summaries) {
+    records = summaries = 0;
+    DIR *dir = opendir(sim::sdRoot());
+    if (dir == NULL) {
+        perror(sim::sdRoot());
+        return false;
+    }
+    bool read = true;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length < 4 || strcmp(entry->d_name + length - 4, ".tph")) continue;
+        char path[256];
+        sim::sdPath(path, sizeof(path), entry->d_name);
+        if (! readLog(path, records, summaries)) read = false;
+    }
+    closedir(dir);
+    return read;
+}
+
+int main(int argc, char **argv) {
+    unsigned long days = 7;
+    if (argc > 1) days = strtoul(argv[1], NULL, 10);
+    if (days == 0) days = 1;
+
+    mkdir("sim_sd", 0755);
+    setenv("TPH_SIM_SD", "sim_sd/timinglogtest", 1);
+
+    Sensors *sensors = new Sensors();
+    LogFile *logFile = LogFile::initSdLogFile(sensors, NULL, true, LogFile::BINARY, LOGINTERVAL);
+    logFile->setBatch(LOGBATCH);
+    logFile->setMaxAge((uint32_t) LOGBATCH * LOGINTERVAL);
+    // each time the card comes up, resetSPI() begins SPI again
+    const uint32_t begins = SPI.stats.begins;
+
+    unsigned long appended = days * 86400 / LOGINTERVAL;
+    for (unsigned long i = 0; i < appended; i++) {
+        sim::advance_us((uint64_t) LOGINTERVAL * 1000000);
+        TIMING_START(CYCLE);
+        TIMING_START(RECORD);
+        DataPoint dp(sensors);
+        logFile->append(dp.record());
+        TIMING_STOP(RECORD);
+        TIMING_STOP(CYCLE);
+        TIMING_END_CYCLE(logFile);
+    }
+    logFile->sync();
+
+    unsigned long records, summaries;
+    if (! readLogs(records, summaries)) return 1;
+    unsigned long batches = (appended + LOGBATCH - 1) / LOGBATCH;
+    uint32_t cardUps = SPI.stats.begins - begins;
+    printf("%lu records in %lu batches: %lu records, %lu timing summary lines in the log, "
+        "card up %u times\n", appended, batches, records, summaries, (unsigned int) cardUps);
+
+    bool failed = false;
+    if (records != appended) {
+        printf("%lu records missing\n", appended - records);
+        failed = true;
+    }
+    // a summary is due every TIMING_SUMMARY_CYCLES, more often than batches
+    if (summaries < batches) {
+        printf("expected a timing summary with each of the %lu batches\n", batches);
+        failed = true;
+    }
+    if (cardUps != batches) {
+        printf("expected the card up once per batch\n");
+        failed = true;
+    }
+    return failed ? 1 : 0;
+}
@@ -3,44 +3,81 @@
 // (c) Mark Busby <mark@BusbyCreations.com>
 //
 // Part of tphMonitor
-// class to hold Data for a single point
+// class to hold Data for a single point: 16 bytes of fixed point, with the
+// other units worked out only when asked for
 
 #ifndef DATAPOINT_HPP
 #define DATAPOINT_HPP
 
+#include <math.h>
 #include "Sensors.hpp"
+#include "LogRecord.hpp"
+#include "Timing.hpp"
 
 class DataPoint {
 public:
-    DateTime dateTime;
-    float batteryVoltage;
-    float bmp280TemperatureC;
-    float si7021TemperatureC;
-    float si7021TemperatureF;
-    float bmp280Pressure;
-    float bmp280PressureAltitudeM;
-    float bmp280PressureAltitudeFt;
-    int si7021Humidity;
+    uint32_t epoch; // unix time from the RTC
+    uint32_t pressurePa; // BMP280
+    uint16_t batteryMillivolts;
+    int16_t bmp280CentiC; // hundredths of a degree C
+    int16_t si7021CentiC;
+    uint16_t humidityPermille; // Si7021 relative humidity
+
+    DataPoint() {} // unset, for History's ring
     DataPoint(Sensors *s, DateTime dt) {
-        dateTime = dt;
+        epoch = dt.unixtime();
         init(s);
     }
     DataPoint(Sensors *s) {
-        dateTime = s->getDateTime();
+        TIMING_START(DATETIME);
+        epoch = s->getDateTime().unixtime();
+        TIMING_STOP(DATETIME);
         init(s);
     }
 
+    DateTime dateTime() const { return DateTime(epoch); }
+    float batteryVoltage() const { return batteryMillivolts / 1000.; }
+    float bmp280Temperature_C() const { return bmp280CentiC / 100.; }
+    float si7021Temperature_C() const { return si7021CentiC / 100.; }
+    float si7021Temperature_F() const { return fahrenheit(si7021CentiC); }
+    float pressure_hPa() const { return hPa(pressurePa); }
+    float pressure_inHg() const { return Sensors::convert_hPa_inHg(pressure_hPa()); }
+    float pressureAltitude_m() const { return Sensors::pressureAltitude_m(pressure_hPa()); }
+    float pressureAltitude_ft() const { return Sensors::convert_m_ft(pressureAltitude_m()); }
+    float humidity_percent() const { return percent(humidityPermille); }
+
+    // the same conversions, for values from History
+    static float fahrenheit(int32_t centiC) { return centiC * 1.8 / 100. + 32; }
+    static float hPa(int32_t pa) { return pa / 100.; }
+    static float percent(int32_t permille) { return permille / 10.; }
+
+    // the binary log keeps the same fields
+    LogRecord record() const {
+        LogRecord r;
+        r.epoch = epoch;
+        r.pressurePa = pressurePa;
+        r.batteryMillivolts = batteryMillivolts;
+        r.bmp280CentiC = bmp280CentiC;
+        r.si7021CentiC = si7021CentiC;
+        r.humidityCentiPercent = humidityPermille * 10;
+        return r;
+    }
+
 private:
     void init(Sensors *s) {
-        batteryVoltage = s->getBatteryVoltage();
-        bmp280TemperatureC = s->getBMP280Temperature_C();
-        si7021TemperatureC = s->getSi7021Temperature_C();
-        si7021TemperatureF = s->getSi7021Temperature_F();
-        bmp280Pressure = s->getBMP280Pressure_hPa();
-        bmp280PressureAltitudeM = s->getBMP280PressureAltitude_m();
-        bmp280PressureAltitudeFt = s->getPressureAltitude_ft();
-        si7021Humidity = s->getSi7021Humidity_percent();
+        TIMING_START(ACQUIRE);
+        SensorSnapshot snapshot = s->acquire();
+        TIMING_STOP(ACQUIRE);
+        TIMING_START(CONVERT);
+        pressurePa = s->bmp280Pressure_Pa(snapshot);
+        batteryMillivolts = s->batteryMillivolts(snapshot);
+        bmp280CentiC = s->bmp280CentiC(snapshot);
+        si7021CentiC = snapshot.si7021CentiC;
+        humidityPermille = snapshot.si7021HumidityBasisPoints / 10;
+        TIMING_STOP(CONVERT);
     }
 };
 
+static_assert(sizeof(DataPoint) == 16, "DataPoint must stay 16 bytes");
+
 #endif // DATAPOINT_HPP
@@ -5,12 +5,20 @@
 // Part of tphMonitor
 // Create a vertical bar (thermometer style) with low, high, and current markings
 // and display it in one of three sections of a 2" Papirus e-paper display
+//
+// A Gauge is retained: drawBackground() puts the title and the scale in the
+// static layout once, and after that draw() only redraws the parts whose
+// pixels change -- the bar by the rows between its old and new height, and a
+// value only when its text does -- and tells Papirus the rectangles it touched.
 
 #ifndef GAUGE_HPP
 #define GAUGE_HPP
 
+#include <new>
 #include "Papirus.hpp"
 
+#define GAUGE_TITLE_SIZE 16 // characters, with the terminator
+
 class Gauge {
 public:
     enum POSITION { ONE, TWO, THREE };
@@ -18,10 +26,17 @@ public:
     static Gauge *GaugeMaker(Papirus *papirus, POSITION position,
         const char *title, float min, float max, float major, float minor = 0);
 
+    // the title and the scale; part of the static layout, so draw before
+    // Papirus::saveBackground()
     void setTitle(const char *title);
+    void drawBackground();
+
     void setCurrentValue(float value); // also updates low and high as appropriate
     void setLowValue(float value);
     void setHighValue(float value);
+
+    // redraw whatever has changed since the last draw(), false if nothing did
+    bool draw();
     ~Gauge();
 
 private:
@@ -34,8 +49,8 @@ private:
     static const Gauge *gaugeThree;
 
     const POSITION position;
-    int x, y, width, height; // coordinates and bounds
-    char *title;
+    int x; // the scale's axis
+    char title[GAUGE_TITLE_SIZE];
     bool titleSet;
     const float minValue;
     const float maxValue;
@@ -44,6 +59,14 @@ private:
     float lowValue;
     const float majorTick;
     const float minorTick;
+
+    // what is on the panel now
+    int drawnBar; // px
+    char drawnLow[sizeof("-XXX.XXX")]; // empty when not shown
+    char drawnCurrent[sizeof("-XXX.XXX")];
+    char drawnHigh[sizeof("-XXX.XXX")];
+
+    bool drawValue(int y, const char *text, char *drawn);
 };
 
 Papirus *Gauge::papirus = NULL;
@@ -54,27 +77,29 @@ const Gauge* Gauge::gaugeThree = NULL;
 Gauge *Gauge::GaugeMaker(Papirus *papirus, Gauge::POSITION position,
     const char *title, float min, float max, float major, float minor) {
     Gauge *nGauge;
+    // a Gauge for each position, in static storage (end one with ~Gauge())
+    alignas(Gauge) static uint8_t storage[3][sizeof(Gauge)];
+
+    if (Gauge::papirus == NULL) Gauge::papirus = papirus;
 
     // only one Gauge can exist in each position
     switch (position) {
     case Gauge::POSITION::ONE:
-        if (Gauge::gaugeOne == NULL) gaugeOne = nGauge = new Gauge(position, title, min, max, major, minor);
+        if (Gauge::gaugeOne == NULL) gaugeOne = nGauge = new (storage[position]) Gauge(position, title, min, max, major, minor);
         else return NULL;
         break;
     case Gauge::POSITION::TWO:
-        if (Gauge::gaugeTwo == NULL) gaugeTwo = nGauge = new Gauge(position, title, min, max, major, minor);
+        if (Gauge::gaugeTwo == NULL) gaugeTwo = nGauge = new (storage[position]) Gauge(position, title, min, max, major, minor);
         else return NULL;
         break;
     case Gauge::POSITION::THREE:
-        if (Gauge::gaugeThree == NULL) gaugeThree = nGauge = new Gauge(position, title, min, max, major, minor);
+        if (Gauge::gaugeThree == NULL) gaugeThree = nGauge = new (storage[position]) Gauge(position, title, min, max, major, minor);
         else return NULL;
         break;
     default:
         return NULL;
     }
 
-    if (Gauge::papirus == NULL) Gauge::papirus = papirus;
-
     return nGauge;
 }
 
@@ -85,43 +110,32 @@ Gauge::Gauge(POSITION pos, const char *title, float min, float max,
     titleSet = false;
     setTitle(title);
 
-    width = 66; // panel width minus left and right columns (for border)
-    height = 94; // panel height minus top and bottom rows (for border)
-    y = 2;
+    // sections are a third of the panel wide, the scale at the right of each
+    x = 60 + 66 * position;
 
-    // TODO: draw a border around the appropriate section
-    switch (position) {
-    case Gauge::POSITION::ONE:
-        x = 1;
-        break;
-    case Gauge::POSITION::TWO:
-        x = 1 + width;
-        break;
-    case Gauge::POSITION::THREE:
-        x = 1 + width + width;
-        break;
-    }
+    lowValue = highValue = currentValue = min;
 
-    papirus->addBorder(x, y, width, height, 1);
-
-    // TODO: Create the gauge, thermometer style, in the appropriate spot
+    // nothing drawn yet: the background has an empty bar and no values
+    drawnBar = 0;
+    drawnLow[0] = drawnCurrent[0] = drawnHigh[0] = '\0';
 }
 
 void Gauge::setTitle(const char *newTitle) {
     titleSet = true;
 
-    // create a copy of title -- needed for later title changes
-    this->title = new char[sizeof(newTitle)];
-    memcpy(this->title, title, sizeof(newTitle));
+    // keep a copy of title -- needed for later title changes
+    strncpy(this->title, newTitle, sizeof(this->title) - 1);
+    this->title[sizeof(this->title) - 1] = '\0';
+}
 
-    // TODO: Print the title at the top
-    // TODO: Print a line under the title (underline)
+void Gauge::drawBackground() {
+    // the title over the section, clear of the border in the first
+    if (titleSet) papirus->addText(position == ONE ? 1 + 2 : 66 * position + 2, 14, title, 1);
+    papirus->addVertAxis(x, minValue, maxValue, majorTick, minorTick);
 }
 
 void Gauge::setCurrentValue(float value) {
-    // TODO: print the value to the center-left of the gauge
-    // TODO: draw a small filled triangle pointing to the appropriate place on the gauge
-    // TODO: draw a black rectangle filling in the gauge to the appropriate height
+    currentValue = value;
 
     if (lowValue > value) setLowValue(value);
     if (highValue < value) setHighValue(value);
@@ -129,22 +143,64 @@ void Gauge::setCurrentValue(float value) {
 
 void Gauge::setLowValue(float value) {
     lowValue = value;
-
-    if (currentValue - lowValue < 0.0001) {
-        // TODO: draw a small unfilled triangle point to the appropriate place on the gauge
-    }
-
-    // TODO: print the value at the bottom left of the gauge
 }
 
 void Gauge::setHighValue(float value) {
     highValue = value;
+}
 
-    if (highValue - currentValue < 0.0001) {
-        // TODO: draw a small unfilled triangle point to the appropriate place on the gauge
+bool Gauge::draw() {
+    // the same geometry as Papirus::addVertBar()
+    if (minValue > maxValue) return false;
+
+    const int bottom = VERTSCALE_BOTTOM;
+    const int top = VERTSCALE_TOP;
+    const int heightPx = bottom - top;
+    const int barWidth = 4;
+    const float pxScale = heightPx / (maxValue - minorTick);
+
+    float value = currentValue;
+    if (value > maxValue) value = maxValue;
+    else if (value < minValue) value = minValue;
+
+    bool changed = false;
+    int barHeight = (value - minValue) * pxScale;
+    if (barHeight != drawnBar) {
+        // only the rows between the old top of the bar and the new one
+        if (barHeight > drawnBar) {
+            papirus->epd_gfx.fillRect(x + 1, bottom - barHeight, barWidth, barHeight - drawnBar, EPD_GFX::BLACK);
+            papirus->markDrawn();
+        }
+        else {
+            papirus->epd_gfx.fillRect(x + 1, bottom - drawnBar, barWidth, drawnBar - barHeight, EPD_GFX::WHITE);
+            papirus->markDrawn();
+        }
+        drawnBar = barHeight;
+        changed = true;
     }
 
-    // TODO: print the value at the top left of the gauge
+    char valStr[sizeof("-XXX.XXX")] = "";
+    if (lowValue < value) Papirus::valToString(lowValue, valStr, sizeof(valStr));
+    changed |= drawValue(bottom - 7, valStr, drawnLow);
+
+    Papirus::valToString(value, valStr, sizeof(valStr));
+    changed |= drawValue((top + bottom) / 2, valStr, drawnCurrent);
+
+    valStr[0] = '\0';
+    if (highValue > value) Papirus::valToString(highValue, valStr, sizeof(valStr));
+    changed |= drawValue(top + 7, valStr, drawnHigh);
+
+    return changed;
+}
+
+// a value at the left of the scale, when its text differs from what's drawn
+bool Gauge::drawValue(int y, const char *text, char *drawn) {
+    if (! strcmp(text, drawn)) return false;
+
+    papirus->restoreBackground(x - 50, y, 6 * (sizeof(drawnLow) - 1), 8);
+    if (text[0]) papirus->addText(x - 50, y, text, 1);
+    strcpy(drawn, text);
+    return true;
 }
 
 Gauge::~Gauge() {
@@ -159,8 +215,6 @@ Gauge::~Gauge() {
         gaugeThree = NULL;
         break;
     }
-
-    delete[] title;
 }
 
 #endif // GAUGE_HPP
@@ -0,0 +1,176 @@
+// History.hpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor
+// The last day of data points in a RAM ring, with rolling min/max/mean of
+// temperature, pressure and humidity over a short and a long window.  Each
+// window keeps a running sum and a pair of monotonic deques (ring slots in
+// increasing/decreasing order of value), so adding a sample and evicting the
+// ones that fell out of the window costs O(1) amortized, without rescanning.
+// All of it is sized for HISTORY_SAMPLES at compile time and lives wherever
+// the History does, off the heap.
+
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <Arduino.h>
+#include "DataPoint.hpp"
+
+#ifndef HISTORY_SAMPLES
+#define HISTORY_SAMPLES 145 // a day at the normal LOGINTERVAL, both ends (2320 bytes)
+#endif
+#ifndef HISTORY_SHORT_WINDOW
+#define HISTORY_SHORT_WINDOW 3600 // seconds
+#endif
+#ifndef HISTORY_LONG_WINDOW
+#define HISTORY_LONG_WINDOW 86400 // seconds, up to HISTORY_SAMPLES samples
+#endif
+
+class History {
+public:
+    enum Quantity {
+        TEMPERATURE, // Si7021, hundredths of a degree C
+        PRESSURE, // Pa
+        HUMIDITY, // permille
+        QUANTITIES
+    };
+    enum Window { SHORT, LONG, WINDOWS };
+
+    History(uint16_t interval);
+    void add(const DataPoint &dataPoint);
+
+    uint16_t size() const { return count; }
+    const DataPoint &operator[](uint16_t age) const; // 0 is the newest
+
+    // over the samples in the window, 0 while empty
+    uint16_t samples(Window window) const { return held[window]; }
+    int32_t minimum(Quantity quantity, Window window) const;
+    int32_t maximum(Quantity quantity, Window window) const;
+    int32_t mean(Quantity quantity, Window window) const;
+
+private:
+    // ring slots, oldest at head
+    struct Deque {
+        uint16_t slots[HISTORY_SAMPLES];
+        uint16_t capacity; // the window's limit, up to HISTORY_SAMPLES
+        uint16_t head;
+        uint16_t length;
+
+        uint16_t front() const { return slots[head]; }
+        uint16_t back() const { return slots[(head + length - 1) % capacity]; }
+        void push(uint16_t slot) { slots[(head + length++) % capacity] = slot; }
+        void popFront() { head = (head + 1) % capacity; length--; }
+        void popBack() { length--; }
+    };
+
+    DataPoint ring[HISTORY_SAMPLES];
+    uint16_t capacity;
+    uint16_t newest; // slot of the newest sample
+    uint16_t count;
+    uint32_t seconds[WINDOWS];
+    uint16_t limit[WINDOWS]; // samples a window can hold
+    uint16_t oldest[WINDOWS]; // slot of the oldest sample in the window
+    uint16_t held[WINDOWS];
+    int32_t sum[QUANTITIES][WINDOWS];
+    Deque lows[QUANTITIES][WINDOWS]; // values increasing from the front
+    Deque highs[QUANTITIES][WINDOWS]; // values decreasing from the front
+
+    void evictOldest(Window window);
+    static int32_t value(const DataPoint &dataPoint, Quantity quantity);
+};
+
+History::History(uint16_t interval) {
+    seconds[SHORT] = HISTORY_SHORT_WINDOW;
+    seconds[LONG] = HISTORY_LONG_WINDOW;
+    capacity = 0;
+    for (int w = 0; w < WINDOWS; w++) {
+        uint32_t samples = seconds[w] / interval + 1;
+        limit[w] = samples < HISTORY_SAMPLES ? samples : HISTORY_SAMPLES;
+        if (limit[w] > capacity) capacity = limit[w];
+        oldest[w] = 0;
+        held[w] = 0;
+        for (int q = 0; q < QUANTITIES; q++) {
+            sum[q][w] = 0;
+            lows[q][w].capacity = highs[q][w].capacity = limit[w];
+            lows[q][w].head = highs[q][w].head = 0;
+            lows[q][w].length = highs[q][w].length = 0;
+        }
+    }
+    newest = capacity - 1;
+    count = 0;
+}
+
+void History::add(const DataPoint &dataPoint) {
+    // a window that's full drops its oldest sample first, so a window never
+    // refers to a ring slot that has been reused
+    for (int w = 0; w < WINDOWS; w++) {
+        if (held[w] == limit[w]) evictOldest((Window) w);
+    }
+
+    newest = (newest + 1) % capacity;
+    ring[newest] = dataPoint;
+    if (count < capacity) count++;
+
+    for (int w = 0; w < WINDOWS; w++) {
+        if (! held[w]) oldest[w] = newest;
+        held[w]++;
+        for (int q = 0; q < QUANTITIES; q++) {
+            int32_t v = value(dataPoint, (Quantity) q);
+            sum[q][w] += v;
+            Deque &low = lows[q][w];
+            while (low.length && value(ring[low.back()], (Quantity) q) >= v) low.popBack();
+            low.push(newest);
+            Deque &high = highs[q][w];
+            while (high.length && value(ring[high.back()], (Quantity) q) <= v) high.popBack();
+            high.push(newest);
+        }
+
+        // then everything that has aged out
+        while (held[w] > 1 && dataPoint.epoch - ring[oldest[w]].epoch >= seconds[w]) {
+            evictOldest((Window) w);
+        }
+    }
+}
+
+void History::evictOldest(Window w) {
+    uint16_t slot = oldest[w];
+    for (int q = 0; q < QUANTITIES; q++) {
+        sum[q][w] -= value(ring[slot], (Quantity) q);
+        if (lows[q][w].front() == slot) lows[q][w].popFront();
+        if (highs[q][w].front() == slot) highs[q][w].popFront();
+    }
+    oldest[w] = (slot + 1) % capacity;
+    held[w]--;
+}
+
+const DataPoint &History::operator[](uint16_t age) const {
+    return ring[(newest + capacity - age) % capacity];
+}
+
+int32_t History::minimum(Quantity quantity, Window window) const {
+    if (! held[window]) return 0;
+    return value(ring[lows[quantity][window].front()], quantity);
+}
+
+int32_t History::maximum(Quantity quantity, Window window) const {
+    if (! held[window]) return 0;
+    return value(ring[highs[quantity][window].front()], quantity);
+}
+
+int32_t History::mean(Quantity quantity, Window window) const {
+    if (! held[window]) return 0;
+    int32_t s = sum[quantity][window];
+    return (s + (s < 0 ? -held[window] : held[window]) / 2) / held[window];
+}
+
+int32_t History::value(const DataPoint &dataPoint, Quantity quantity) {
+    switch (quantity) {
+    case TEMPERATURE: return dataPoint.si7021CentiC;
+    case PRESSURE: return dataPoint.pressurePa;
+    case HUMIDITY: return dataPoint.humidityPermille;
+    default: return 0;
+    }
+}
+
+#endif // HISTORY_HPP
@@ -0,0 +1,204 @@
+// Journal.hpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor
+// The data points, as they are taken, in a ring of spare EPD_FLASH sectors,
+// so History can be filled again after a reset or brown-out without powering
+// up the SD card.
+//
+// Each sector starts with a header slot (JOURNAL_MAGIC and a sequence number,
+// one more than the sector before it), then JOURNAL_SLOTS - 1 DataPoints
+// written in order.  Slots are 16 bytes and page aligned, so an append is a
+// single program of part of one EPD_FLASH_PAGE_SIZE page.  When a sector is
+// full the next one in the ring is erased, so the erases go round the ring and
+// the sector before the head always holds a full sector of older samples.
+//
+// Finding the head at power on reads the sector headers, then does a binary
+// search on the epochs in the newest sector, whose written slots all come
+// before its erased ones: about a dozen small reads in all.
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <Arduino.h>
+#include <EPD_FLASH.h>
+#include "Papirus.hpp" // EPD_FLASH is set up by Papirus, and the frames go first
+#include "DataPoint.hpp"
+#include "History.hpp"
+
+// the first sector after those Papirus keeps frames in
+#ifndef JOURNAL_FIRST_SECTOR
+#if defined(EPD_GFX_FLASH_FRAMES)
+#define JOURNAL_FIRST_SECTOR ((EPD_GFX_FLASH_IMAGE >> EPD_FLASH_SECTOR_SHIFT) + EPD_GFX_FLASH_FRAMES)
+#else
+#define JOURNAL_FIRST_SECTOR EPD_FLASH_SECTORS_USED
+#endif
+#endif
+#ifndef JOURNAL_SECTORS
+#define JOURNAL_SECTORS 4 // of 255 samples (1.8 days at LOGINTERVAL), so each
+                          // sector is erased about weekly and the ring holds
+                          // about 7 days
+#endif
+
+#define JOURNAL_MAGIC 0x4a485054UL // "TPHJ"
+#define JOURNAL_SLOTS (EPD_FLASH_SECTOR_SIZE / sizeof(DataPoint))
+#define JOURNAL_ERASED 0xffffffffUL // an epoch never written
+
+static_assert(EPD_FLASH_PAGE_SIZE % sizeof(DataPoint) == 0,
+    "a journal slot must not straddle flash pages");
+
+class Journal {
+public:
+    // find the head of the journal, or start one
+    Journal(uint16_t firstSector = JOURNAL_FIRST_SECTOR, uint16_t sectors = JOURNAL_SECTORS);
+    bool available() const { return sectors != 0; } // false if EPD_FLASH didn't answer
+
+    void append(const DataPoint &dataPoint);
+    // add up to count of the newest samples to history, oldest first,
+    // returning how many
+    uint16_t replay(History *history, uint16_t count);
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t reserved[2];
+    };
+    static_assert(sizeof(Header) == sizeof(DataPoint), "the header fills a slot");
+
+    uint32_t first; // address of the first sector
+    uint16_t sectors; // 0 if there is no journal
+    uint16_t sector; // in the ring, where the head is
+    uint32_t sequence; // of that sector
+    uint16_t slot; // next free slot in it
+
+    uint32_t address(uint16_t ringSector, uint16_t slot) const;
+    bool readHeader(uint16_t ringSector, uint32_t *sequence) const;
+    uint32_t readEpoch(uint16_t ringSector, uint16_t slot) const;
+    void nextSector();
+};
+
+Journal::Journal(uint16_t firstSector, uint16_t sectors) {
+    first = (uint32_t) firstSector << EPD_FLASH_SECTOR_SHIFT;
+    this->sectors = EPD_FLASH.available() && sectors >= 2 ? sectors : 0;
+    sector = 0;
+    sequence = 0;
+    slot = JOURNAL_SLOTS;
+    if (! this->sectors) return;
+
+    // the newest sector, from the headers alone
+    bool found = false;
+    for (uint16_t s = 0; s < this->sectors; s++) {
+        uint32_t seq;
+        if (readHeader(s, &seq) && (! found || seq > sequence)) {
+            found = true;
+            sector = s;
+            sequence = seq;
+        }
+    }
+    if (! found) {
+        sector = this->sectors - 1;
+        nextSector();
+        DEBUGPRINTLN("Journal: started");
+        return;
+    }
+
+    // the head is the first erased slot: a binary search on the epochs
+    uint16_t low = 1, high = JOURNAL_SLOTS;
+    while (low < high) {
+        uint16_t middle = (low + high) / 2;
+        if (readEpoch(sector, middle) == JOURNAL_ERASED) high = middle;
+        else low = middle + 1;
+    }
+    slot = low;
+    DEBUGPRINT("Journal: sector ");
+    DEBUGPRINT(sector);
+    DEBUGPRINT(", slot ");
+    DEBUGPRINTLN(slot);
+}
+
+void Journal::append(const DataPoint &dataPoint) {
+    if (! sectors) return;
+    if (slot == JOURNAL_SLOTS) nextSector();
+
+    EPD_FLASH.write_enable();
+    EPD_FLASH.write(address(sector, slot), &dataPoint, sizeof(dataPoint));
+    slot++;
+}
+
+uint16_t Journal::replay(History *history, uint16_t count) {
+    if (! sectors) return 0;
+
+    // back from the head, into the sector before if it follows on
+    uint16_t ringSector = sector;
+    uint16_t start = slot;
+    uint16_t held = slot - 1;
+    uint16_t before = (sector + sectors - 1) % sectors;
+    uint32_t seq;
+    if (held < count && readHeader(before, &seq) && seq == sequence - 1) {
+        held += JOURNAL_SLOTS - 1;
+    }
+    if (count > held) count = held;
+    for (uint16_t n = count; n; n--) {
+        if (start == 1) {
+            ringSector = before;
+            start = JOURNAL_SLOTS;
+        }
+        start--;
+    }
+
+    // then forwards a page at a time
+    DataPoint page[EPD_FLASH_PAGE_SIZE / sizeof(DataPoint)];
+    uint16_t added = 0;
+    for (uint16_t n = 0; n < count; ) {
+        uint16_t length = sizeof(page) / sizeof(page[0]) - start % (sizeof(page) / sizeof(page[0]));
+        if (length > JOURNAL_SLOTS - start) length = JOURNAL_SLOTS - start;
+        if (length > count - n) length = count - n;
+        EPD_FLASH.read(page, address(ringSector, start), length * sizeof(DataPoint));
+        for (uint16_t i = 0; i < length; i++) {
+            if (page[i].epoch == JOURNAL_ERASED) continue; // a torn sector
+            history->add(page[i]);
+            added++;
+        }
+        n += length;
+        start += length;
+        if (start == JOURNAL_SLOTS) {
+            ringSector = (ringSector + 1) % sectors;
+            start = 1;
+        }
+    }
+    return added;
+}
+
+uint32_t Journal::address(uint16_t ringSector, uint16_t slot) const {
+    return first + ((uint32_t) ringSector << EPD_FLASH_SECTOR_SHIFT) + slot * sizeof(DataPoint);
+}
+
+bool Journal::readHeader(uint16_t ringSector, uint32_t *sequence) const {
+    Header header;
+    EPD_FLASH.read(&header, address(ringSector, 0), sizeof(header));
+    *sequence = header.sequence;
+    return header.magic == JOURNAL_MAGIC && header.sequence != JOURNAL_ERASED;
+}
+
+uint32_t Journal::readEpoch(uint16_t ringSector, uint16_t slot) const {
+    uint32_t epoch;
+    EPD_FLASH.read(&epoch, address(ringSector, slot), sizeof(epoch));
+    return epoch;
+}
+
+// erase the next sector in the ring and start writing there
+void Journal::nextSector() {
+    sector = (sector + 1) % sectors;
+    sequence++;
+    uint32_t start = address(sector, 0);
+    EPD_FLASH.write_enable();
+    EPD_FLASH.sector_erase(start);
+    Header header = { JOURNAL_MAGIC, sequence, { JOURNAL_ERASED, JOURNAL_ERASED } };
+    EPD_FLASH.write_enable();
+    EPD_FLASH.write(start, &header, sizeof(header));
+    slot = 1;
+}
+
+#endif // JOURNAL_HPP
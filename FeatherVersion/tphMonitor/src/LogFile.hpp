@@ -5,6 +5,22 @@
 // Part of tphMonitor
 // Abstract much of the tedium of working with the SD Card
 // Requires Sensors.h (requires RTC)
+// Logs either as pipe-delimited text or as binary records (see LogRecord.hpp,
+// decode with tools/tphLogDecode).  Binary records collect in a RAM image of
+// one SD sector, which is only written when it fills, when a batch of
+// records has collected, or when its oldest record is LOGFILE_MAX_AGE seconds
+// old.  Each binary file is preallocated contiguously for LOGFILE_PERIOD
+// days of records, and sectors are written straight to their card blocks,
+// without touching the FAT or directory.
+//
+// A binary log only has the card up while it writes: records wait in the
+// sector image for a batch (setBatch()), then the card is brought up,
+// written and let go again.  With SDPOWER it is powered and mounted for each
+// batch; without, it stays powered and mounted, and letting it go deselects
+// it so it drops to its idle current.  The samples are in the Journal
+// meanwhile, for History; sync() writes whatever is waiting, e.g. on low
+// battery.  cardOnMillis() says how long the card was up each day, and
+// setBatchComments() adds comments while it is, e.g. the timing summary.
 
 #ifndef LOGFILE_HPP
 #define LOGFILE_HPP
@@ -12,19 +28,68 @@
 // Pin Selections for Adafruit M0 Adalogger
 #define CARDSELECT 4
 #define SDLED 8
+// #define SDPOWER 5 // a load switch on the card's supply, HIGH for on; the
+                     // Adalogger has none, so without it the card is only
+                     // deselected between batches
+#define SDPOWER_SETTLE_MS 5 // supply up to the card taking commands
 
+#include <new>
 #include <SPI.h>
 #include <SdFat.h>
 #include "Sensors.hpp"
+#include "LogRecord.hpp"
 #include <DEBUG.h>
 
+#define LOGFILE_SLOT_SIZE 512 // one SD sector per slot of a binary log
+#ifndef LOGFILE_MAX_AGE
+#define LOGFILE_MAX_AGE 3600 // seconds a record may wait in RAM (setMaxAge())
+#endif
+#ifndef LOGFILE_PERIOD
+#define LOGFILE_PERIOD 30 // days of records preallocated per binary file
+#endif
+#ifndef LOGFILE_BATCH
+#define LOGFILE_BATCH 0 // records held in RAM for one write (setBatch())
+#endif
+#ifndef LOGFILE_RAW
+#define LOGFILE_RAW 1 // 0 to write sectors through the file instead
+#endif
+
 class LogFile {
 public:
-    ofstream stream; // make a stream available
+    enum Format { TEXT, BINARY };
+
+    ofstream stream; // make a stream available (TEXT format only)
     const char *getFileName () const;
+    Format getFormat() const;
+
+    // BINARY format: add a record to the sector image, writing it to the
+    // card when it is full or its oldest unwritten record is too old
+    bool append(const LogRecord &record);
+    // write any records still only in RAM
+    bool sync();
+    // seconds a record may wait in RAM before it is written, 0 to write
+    // every record as it comes
+    void setMaxAge(uint32_t seconds);
+    // records to hold in RAM before the card is brought up to write them, 1
+    // to write every record as it comes, 0 to go by the sector filling and
+    // the age alone
+    void setBatch(uint16_t records);
+    // how long the card was up (BINARY format): powered with SDPOWER,
+    // otherwise selected, as it is powered all the time.  The day in
+    // progress when daysAgo is 0, the whole day before it when 1
+    uint32_t cardOnMillis(uint8_t daysAgo = 0) const;
+    // a line of text that is not a data point, e.g. the timing summary
+    bool comment(const char *text);
+    // BINARY format: called each time the card comes up to write, to add
+    // comments that go with the batch rather than bring the card up on
+    // their own, NULL for none
+    void setBatchComments(void (*addComments)(LogFile *logFile));
 
     // use a static function to create new LogFile objects
-    static LogFile *initSdLogFile(Sensors *sensors, SdFat *sd, bool useLongFileName = true);
+    // logInterval (seconds between records) sizes the preallocated BINARY file
+    // there is one LogFile, in static storage: calling again replaces it
+    static LogFile *initSdLogFile(Sensors *sensors, SdFat *sd, bool useLongFileName = true,
+        Format format = TEXT, uint16_t logInterval = 600);
     static void sdDateTimeCallback(uint16_t *date, uint16_t *time);
     static void resetSPI();
     ~LogFile();
@@ -32,8 +97,42 @@ public:
 private:
     // constructor requires a working SdFat object, so only allow construction
     // via static function LogFile::initSdLogFile(...)
-    LogFile(const DateTime &dt, SdFat *sd, bool useLongFileName = true);
-    char fileName[23]; // allocate enough space for long filename
+    LogFile(const DateTime &dt, SdFat *sd, bool useLongFileName, Format format,
+        uint16_t logInterval);
+    char fileName[sizeof("/YYYY.MM.DD-HHMM_SS.log")]; // allocate enough space for long filename
+    bool useLongFileName;
+    Format format;
+
+    // BINARY format
+    SdFile file;
+    uint32_t created; // seeds the block CRCs, with the slot
+    uint32_t slots; // slots preallocated in each file
+    uint32_t firstBlock; // card block of slot 0 for raw writes, 0 if not raw
+    uint32_t slot; // where the sector image goes in the file
+    uint8_t sector[LOGFILE_SLOT_SIZE]; // image of the slot being filled
+    uint16_t sectorUsed; // bytes of blocks in the image
+    int16_t openBlock; // offset of the records block still growing, -1 if none
+    bool unwritten; // image holds data that isn't on the card yet
+    uint32_t unwrittenSince; // epoch of the oldest unwritten record
+    uint16_t pending; // records in the image that aren't on the card yet
+    uint32_t maxAge;
+    uint16_t batch;
+
+    // the card, only up while it is written to in BINARY format
+    bool cardUp;
+    uint32_t cardStarted; // micros() when it came up
+    uint32_t cardDay; // epoch / 86400 of the day cardOnUs[0] is for
+    uint32_t cardOnUs[2]; // that day so far, and the day before
+    void (*batchComments)(LogFile *logFile);
+    bool addingComments; // in batchComments, its writes don't call it again
+    bool powerUp();
+    void powerDown();
+    void startBinary(const DateTime &dt);
+    bool resumeBinary();
+    bool nextSlot();
+    bool writeSlot();
+    bool reserve(uint16_t length);
+    void sealBlock(uint16_t offset, uint8_t marker, uint8_t count, uint16_t length);
     static bool callbackSet; // only need to set SdFile::dateTimeCallback once
     // static SdFat sd;
     // static Sensors sensors;
@@ -49,7 +148,8 @@ Sensors *LogFile::sensors = NULL;
 bool LogFile::callbackSet = false;
 
 // Static function that creates the file
-LogFile *LogFile::initSdLogFile(Sensors *sensors, SdFat *sd, bool useLongFileName) {
+LogFile *LogFile::initSdLogFile(Sensors *sensors, SdFat *sd, bool useLongFileName, Format format,
+    uint16_t logInterval) {
     DEBUGPRINTLN("LogFile::initSdLogFile()");
     LogFile::sensors = sensors;
 
@@ -57,7 +157,13 @@ LogFile *LogFile::initSdLogFile(Sensors *sensors, SdFat *sd, bool useLongFileNam
         pinMode(SDLED, OUTPUT); // LED for SD Card (pin 8)
         pinMode(CARDSELECT, OUTPUT); // The cardSelect pin must be set for output
         pinMode(SS, OUTPUT);
-        sd = new SdFat();
+        #ifdef SDPOWER
+        pinMode(SDPOWER, OUTPUT);
+        digitalWrite(SDPOWER, HIGH);
+        delay(SDPOWER_SETTLE_MS);
+        #endif
+        static SdFat card;
+        sd = &card;
 
         #ifdef DEBUG
         sd->errorPrint();
@@ -70,6 +176,7 @@ LogFile *LogFile::initSdLogFile(Sensors *sensors, SdFat *sd, bool useLongFileNam
         SdFile::dateTimeCallback(LogFile::sdDateTimeCallback);
     }
 
+    uint32_t started = micros();
     while (! sd->begin(CARDSELECT, SPI_HALF_SPEED)) {
         #ifdef DEBUG
         static int attempts = 1;
@@ -83,11 +190,38 @@ LogFile *LogFile::initSdLogFile(Sensors *sensors, SdFat *sd, bool useLongFileNam
     }
 
     // SdFat.h library can use long file names!  Use the short filename with the older "SD.h" library
-    return (new LogFile(sensors->getDateTime(), sd, useLongFileName));
+    static LogFile *logFile = NULL;
+    alignas(LogFile) static uint8_t storage[sizeof(LogFile)];
+    if (logFile != NULL) logFile->~LogFile();
+    logFile = new (storage) LogFile(sensors->getDateTime(), sd, useLongFileName, format, logInterval);
+
+    // a binary log only needs the card again for its first batch
+    logFile->cardStarted = started;
+    if (format == BINARY) logFile->powerDown();
+    return logFile;
 }
 
-LogFile::LogFile(const DateTime &dt, SdFat *sd, bool useLongFileName) {
+LogFile::LogFile(const DateTime &dt, SdFat *sd, bool useLongFileName, Format format,
+    uint16_t logInterval) {
     this->sd = sd;
+    this->useLongFileName = useLongFileName;
+    this->format = format;
+    this->maxAge = LOGFILE_MAX_AGE;
+    this->batch = LOGFILE_BATCH;
+    this->pending = 0;
+    this->cardUp = true; // initSdLogFile() mounted it
+    this->cardStarted = micros();
+    this->cardDay = dt.unixtime() / 86400;
+    this->cardOnUs[0] = this->cardOnUs[1] = 0;
+    this->batchComments = NULL;
+    this->addingComments = false;
+
+    // the header slot, a period of full record slots, and an eighth more for
+    // comments; a file that still fills up early is continued in a new one
+    const uint32_t perSlot = (LOGFILE_SLOT_SIZE - sizeof(LogBlockHeader)) / sizeof(LogRecord);
+    uint32_t records = LOGFILE_PERIOD * 86400UL / (logInterval ? logInterval : 1);
+    uint32_t recordSlots = (records + perSlot - 1) / perSlot;
+    this->slots = 1 + recordSlots + recordSlots / 8;
 
     if (useLongFileName) {
         longFileName(dt);
@@ -100,6 +234,11 @@ LogFile::LogFile(const DateTime &dt, SdFat *sd, bool useLongFileName) {
     DEBUGPRINT("Attempting to open log file with name: ");
     DEBUGPRINTLN(getFileName());
 
+    if (format == BINARY) {
+        startBinary(dt);
+        return;
+    }
+
     bool printHeader = false; // don't print a header on the file, if it already exists
     if (! sd->exists(getFileName())) printHeader = true;
     else DEBUGPRINTLN("File exists, will not print header.");
@@ -116,6 +255,101 @@ LogFile::LogFile(const DateTime &dt, SdFat *sd, bool useLongFileName) {
     }
 }
 
+// create a new preallocated file for dt (or pick up where an existing one
+// with the same name ends) and write its header
+void LogFile::startBinary(const DateTime &dt) {
+    memset(sector, 0, sizeof(sector));
+    sectorUsed = 0;
+    openBlock = -1;
+    unwritten = false;
+
+    firstBlock = 0;
+    uint32_t lastBlock;
+
+    if (sd->exists(getFileName())) {
+        DEBUGPRINTLN("File exists, will append after its last block.");
+        while (! file.open(getFileName(), O_RDWR)) {
+            DEBUGPRINTLN("Could not open log file, trying again, forever, until opened.");
+        }
+        #if LOGFILE_RAW
+        if (! file.contiguousRange(&firstBlock, &lastBlock)) firstBlock = 0;
+        #endif
+        if (resumeBinary()) return;
+
+        // not a log this build can append to: keep it as .old and start afresh
+        file.close();
+        firstBlock = 0;
+        char aside[sizeof(fileName)];
+        strcpy(aside, fileName);
+        strcpy(aside + strlen(aside) - 3, useLongFileName ? "old" : "OLD");
+        DEBUGPRINT("File is another format, renamed to ");
+        DEBUGPRINTLN(aside);
+        if (! sd->rename(getFileName(), aside)) {
+            // nowhere to write until the time gives a new name (see nextSlot())
+            DEBUGPRINTLN("Could not rename the log file, waiting for a new file name");
+            slot = slots = 0;
+            return;
+        }
+    }
+
+    while (! file.createContiguous(getFileName(), slots * LOGFILE_SLOT_SIZE)) {
+        DEBUGPRINTLN("Could not create log file, trying again, forever, until created.");
+        DEBUGPRINTLN(getFileName());
+    }
+    #if LOGFILE_RAW
+    if (! file.contiguousRange(&firstBlock, &lastBlock)) firstBlock = 0;
+    #endif
+
+    LogFileHeader header;
+    memcpy(header.magic, LOGFILE_MAGIC, sizeof(header.magic));
+    header.version = LOGFILE_VERSION;
+    header.recordSize = sizeof(LogRecord);
+    header.blockSize = LOGFILE_SLOT_SIZE;
+    header.created = created = dt.unixtime();
+    header.reserved = 0;
+    memcpy(sector, &header, sizeof(header));
+    slot = 0;
+    writeSlot();
+
+    slot = 1;
+    memset(sector, 0, sizeof(sector));
+}
+
+// find the first slot without a valid block in an existing file -- its
+// real length, as the preallocated size says nothing about it.  False if the
+// file isn't a log in this build's layout
+bool LogFile::resumeBinary() {
+    LogFileHeader header;
+    if (! file.seekSet(0)
+        || file.read(&header, sizeof(header)) != (int) sizeof(header)
+        || memcmp(header.magic, LOGFILE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != LOGFILE_VERSION
+        || header.recordSize != sizeof(LogRecord)
+        || header.blockSize != LOGFILE_SLOT_SIZE) {
+        return false;
+    }
+    created = header.created;
+    slots = file.fileSize() / LOGFILE_SLOT_SIZE;
+
+    for (slot = 1; slot < slots; slot++) {
+        LogBlockHeader block;
+        uint8_t payload[LOGFILE_SLOT_SIZE];
+        if (! file.seekSet((uint32_t) slot * LOGFILE_SLOT_SIZE)) break;
+        if (file.read(&block, sizeof(block)) != (int) sizeof(block)) break;
+        uint16_t length = block.count;
+        if (block.marker == LOGBLOCK_RECORDS) length *= sizeof(LogRecord);
+        else if (block.marker != LOGBLOCK_COMMENT) break;
+        if (length > LOGFILE_SLOT_SIZE - sizeof(block)) break;
+        if (file.read(payload, length) != (int) length) break;
+        if (logBlockCrc(block.count, payload, length, logSlotSeed(created, slot)) != block.crc) break;
+    }
+
+    // every slot is taken, e.g. after a reset in the same hour: carry on in
+    // a new file rather than past the end of this one
+    if (slot >= slots) nextSlot();
+    return true;
+}
+
 LogFile::~LogFile() {
 
 }
@@ -124,6 +358,236 @@ const char *LogFile::getFileName() const {
     return fileName;
 }
 
+LogFile::Format LogFile::getFormat() const {
+    return format;
+}
+
+bool LogFile::append(const LogRecord &record) {
+    if (format != BINARY) return false;
+
+    if (openBlock < 0 || sectorUsed + sizeof(LogRecord) > LOGFILE_SLOT_SIZE) {
+        if (! reserve(sizeof(LogBlockHeader) + sizeof(LogRecord))) return false;
+        openBlock = sectorUsed;
+        sectorUsed += sizeof(LogBlockHeader);
+    }
+
+    memcpy(sector + sectorUsed, &record, sizeof(record));
+    sectorUsed += sizeof(record);
+    uint16_t length = sectorUsed - openBlock - sizeof(LogBlockHeader);
+    sealBlock(openBlock, LOGBLOCK_RECORDS, length / sizeof(LogRecord), length);
+
+    if (! pending++) unwrittenSince = record.epoch;
+    unwritten = true;
+
+    // the card's time is counted against the day of the records written
+    uint32_t day = record.epoch / 86400;
+    if (day != cardDay) {
+        cardOnUs[1] = day == cardDay + 1 ? cardOnUs[0] : 0;
+        cardOnUs[0] = 0;
+        cardDay = day;
+    }
+
+    // write once the slot can't take another record, there's a batch of
+    // them, or the oldest record has waited long enough
+    if (sectorUsed + sizeof(LogRecord) > LOGFILE_SLOT_SIZE
+        || (batch && pending >= batch)
+        || record.epoch - unwrittenSince >= maxAge) {
+        return writeSlot();
+    }
+    return true;
+}
+
+bool LogFile::sync() {
+    if (format == TEXT) {
+        stream << flush;
+        return stream.good();
+    }
+    return unwritten ? writeSlot() : true;
+}
+
+void LogFile::setMaxAge(uint32_t seconds) {
+    maxAge = seconds;
+}
+
+void LogFile::setBatch(uint16_t records) {
+    batch = records;
+}
+
+uint32_t LogFile::cardOnMillis(uint8_t daysAgo) const {
+    if (daysAgo > 1) return 0;
+    uint32_t us = cardOnUs[daysAgo];
+    if (cardUp && daysAgo == 0) us += micros() - cardStarted;
+    return us / 1000;
+}
+
+void LogFile::setBatchComments(void (*addComments)(LogFile *logFile)) {
+    batchComments = addComments;
+}
+
+bool LogFile::comment(const char *text) {
+    if (format == TEXT) {
+        if (! stream.good()) return false;
+        stream << text << endl << flush;
+        return true;
+    }
+
+    // a comment block holds at most 255 bytes, split longer text
+    size_t length = strlen(text);
+    do {
+        uint8_t count = length > 255 ? 255 : length;
+        if (! reserve(sizeof(LogBlockHeader) + count)) return false;
+        memcpy(sector + sectorUsed + sizeof(LogBlockHeader), text, count);
+        sealBlock(sectorUsed, LOGBLOCK_COMMENT, count, count);
+        sectorUsed += sizeof(LogBlockHeader) + count;
+        openBlock = -1; // records after the comment start a new block
+        text += count;
+        length -= count;
+    } while (length);
+
+    // comments are rare, write them straight away, unless records are
+    // being held for a batch: then they go with it
+    unwritten = true;
+    if (batch > 1) return true;
+    return writeSlot();
+}
+
+// make room for length bytes of blocks in the image, moving on to the next
+// slot if they don't fit
+bool LogFile::reserve(uint16_t length) {
+    if (sectorUsed + length <= LOGFILE_SLOT_SIZE) return true;
+    return nextSlot();
+}
+
+bool LogFile::nextSlot() {
+    // past the end of a full file there is nowhere to write the image to
+    if (unwritten && slot < slots && ! writeSlot()) return false;
+
+    memset(sector, 0, sizeof(sector));
+    sectorUsed = 0;
+    openBlock = -1;
+    unwritten = false;
+    pending = 0;
+
+    if (++slot < slots) return true;
+
+    // the file is full, carry on in a new one -- unless the time still gives
+    // it the same name, then records are lost until it doesn't
+    char fullName[sizeof(fileName)];
+    strcpy(fullName, fileName);
+    DateTime now = sensors->getDateTime();
+    if (useLongFileName) longFileName(now);
+    else shortFileName(now);
+    if (! strcmp(fileName, fullName)) {
+        DEBUGPRINTLN("LogFile: the log file is full, waiting for a new file name");
+        return false;
+    }
+
+    bool wasUp = cardUp;
+    if (! powerUp()) {
+        strcpy(fileName, fullName); // still the file powerUp() opens
+        return false;
+    }
+    file.close();
+    startBinary(now);
+    bool opened = file.isOpen();
+    if (! wasUp) powerDown();
+    return opened;
+}
+
+// write the whole sector image into its slot; a torn write fails the CRC,
+// so at most this slot is lost
+// bringing the card up for it if it isn't
+bool LogFile::writeSlot() {
+    if (slot >= slots) return false; // past the end of a full file
+
+    bool wasUp = cardUp;
+    if (! powerUp()) return false;
+
+    bool written;
+    if (firstBlock) {
+        // straight to the card: no FAT walk, no directory entry update
+        written = sd->card()->writeBlock(firstBlock + slot, sector);
+    }
+    else {
+        written = file.seekSet((uint32_t) slot * LOGFILE_SLOT_SIZE)
+            && file.write(sector, sizeof(sector)) == (int) sizeof(sector)
+            && file.sync();
+    }
+    if (written) {
+        unwritten = false;
+        pending = 0;
+    }
+
+    // while the card is up for the batch anyway: comments after the records,
+    // in as many slots as they take.  The next batch starts a slot of its
+    // own, or filling this one would bring the card up before the batch is in
+    if (written && ! wasUp && batchComments != NULL && ! addingComments) {
+        uint32_t recordsSlot = slot;
+        uint16_t recordsUsed = sectorUsed;
+        addingComments = true;
+        batchComments(this);
+        if (unwritten) written = writeSlot();
+        if (written && (slot != recordsSlot || sectorUsed != recordsUsed)) nextSlot();
+        addingComments = false;
+    }
+
+    if (! wasUp) powerDown();
+    return written;
+}
+
+// get SPI back from the display for the card; with SDPOWER, power up and
+// mount it, and open the file again when it is written through.  False (and
+// the card down) if it doesn't answer
+bool LogFile::powerUp() {
+    if (cardUp) return true;
+
+    cardStarted = micros();
+    #ifdef SDPOWER
+    digitalWrite(SDPOWER, HIGH);
+    delay(SDPOWER_SETTLE_MS);
+    #endif
+    resetSPI();
+    cardUp = true;
+    #ifdef SDPOWER
+    if (! sd->begin(CARDSELECT, SPI_HALF_SPEED)
+        || (! firstBlock && ! file.open(getFileName(), O_RDWR))) {
+        DEBUGPRINTLN("LogFile: the SD card didn't come up, records kept for the next try");
+        powerDown();
+        return false;
+    }
+    #endif
+    // otherwise it is still mounted, and SdFat selects it again for the
+    // next command
+    return true;
+}
+
+// let the card go until the next write: deselect it and end its SPI
+// session, so it idles, and with SDPOWER cut its supply
+void LogFile::powerDown() {
+    if (! cardUp) return;
+
+    #ifdef SDPOWER
+    if (! firstBlock) file.close(); // everything is synced by now
+    #endif
+    sd->card()->spiStop();
+    #ifdef SDPOWER
+    // nothing on the card's select line to power it through its pins
+    digitalWrite(CARDSELECT, LOW);
+    digitalWrite(SDPOWER, LOW);
+    #endif
+    cardOnUs[0] += micros() - cardStarted;
+    cardUp = false;
+}
+
+void LogFile::sealBlock(uint16_t offset, uint8_t marker, uint8_t count, uint16_t length) {
+    LogBlockHeader header;
+    header.marker = marker;
+    header.count = count;
+    header.crc = logBlockCrc(count, sector + offset + sizeof(header), length,
+        logSlotSeed(created, slot));
+    memcpy(sector + offset, &header, sizeof(header));
+}
+
 void LogFile::shortFileName(const DateTime &dt) {
     // create the filename -- this is a hack to turn numbers into ASCII notation
     // "/YYMMDDHH.LOG" -- must use 8.3 file-names (SD library limitation)
@@ -142,8 +606,10 @@ void LogFile::shortFileName(const DateTime &dt) {
     // fileName[12] = 'G';
     // fileName[13] = '\0';
 
-    snprintf(fileName, sizeof("/YYMMDDHH.LOG"), "/%02u%02u%02u%02u.LOG",
-        (dt.year() % 1000) % 100, dt.month(), dt.day(), dt.hour());
+    // each field bounded to its two digits, so the name can't be cut short
+    snprintf(fileName, sizeof("/YYMMDDHH.LOG"), "/%02u%02u%02u%02u.%.3s",
+        dt.year() % 100u, dt.month() % 100u, dt.day() % 100u, dt.hour() % 100u,
+        format == BINARY ? "TPH" : "LOG");
 }
 
 void LogFile::longFileName(const DateTime &dt) {
@@ -174,8 +640,10 @@ void LogFile::longFileName(const DateTime &dt) {
     // fileName[23] = '\0';
 
     snprintf(fileName, sizeof("/YYYY.MM.DD-HHMM_SS.log"),
-        "/%04u.%02u.%02u-%02u%02u_%02u.log",
-        dt.year(), dt.month(), dt.day(), dt.hour(), dt.minute(), dt.second());
+        "/%04u.%02u.%02u-%02u%02u_%02u.%.3s",
+        dt.year() % 10000u, dt.month() % 100u, dt.day() % 100u,
+        dt.hour() % 100u, dt.minute() % 100u, dt.second() % 100u,
+        format == BINARY ? "tph" : "log");
 }
 
 void LogFile::sdDateTimeCallback(uint16_t *dateptr, uint16_t *timeptr) {
@@ -0,0 +1,85 @@
+// LogRecord.hpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor
+// Packed binary log format, shared by LogFile and the host-side decoder in
+// tools/.  Only needs <stdint.h>, so it builds on the host too.  Both ends
+// are little-endian (SAMD21 and x86/ARM hosts), so structs are written as-is.
+//
+// File layout:
+//     LogFileHeader                                          (16 bytes)
+//     blocks, each a LogBlockHeader followed by its payload:
+//         LOGBLOCK_RECORDS   count LogRecords                (16 bytes each)
+//         LOGBLOCK_COMMENT   count bytes of text, no newline
+// A blockSize of 0 in the file header means blocks are packed back to back.
+// Otherwise the file is a run of blockSize slots (SD sectors): the header
+// fills slot 0, and each later slot holds blocks back to back, ending at the
+// first byte that isn't a block marker.  Blocks in a slot seed their CRC with
+// logSlotSeed(), so a slot only decodes once it has been completely written,
+// and stale sectors left over from an older file never decode at all; the
+// log ends at the first slot that doesn't start with a valid block.
+
+#ifndef LOGRECORD_HPP
+#define LOGRECORD_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LOGFILE_MAGIC "TPHL"
+#define LOGFILE_VERSION 1
+
+#define LOGBLOCK_RECORDS 0xB5
+#define LOGBLOCK_COMMENT 0xC5
+
+struct LogFileHeader {
+    char magic[4]; // LOGFILE_MAGIC, no terminator
+    uint8_t version; // LOGFILE_VERSION
+    uint8_t recordSize; // sizeof(LogRecord)
+    uint16_t blockSize; // 0 = packed blocks
+    uint32_t created; // unix time the file was started
+    uint32_t reserved;
+};
+
+struct LogBlockHeader {
+    uint8_t marker; // LOGBLOCK_RECORDS or LOGBLOCK_COMMENT
+    uint8_t count; // records, or comment bytes
+    uint16_t crc; // logCrc16() over count and the payload
+};
+
+// one sample, fixed point
+struct LogRecord {
+    uint32_t epoch; // unix time from the RTC
+    uint32_t pressurePa; // BMP280 pressure
+    uint16_t batteryMillivolts;
+    int16_t bmp280CentiC; // BMP280 temperature, hundredths of a degree C
+    int16_t si7021CentiC; // Si7021 temperature, hundredths of a degree C
+    uint16_t humidityCentiPercent; // Si7021 relative humidity
+};
+
+static_assert(sizeof(LogFileHeader) == 16, "LogFileHeader must be 16 bytes");
+static_assert(sizeof(LogBlockHeader) == 4, "LogBlockHeader must be 4 bytes");
+static_assert(sizeof(LogRecord) == 16, "LogRecord must be 16 bytes");
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xffff); pass the previous result as
+// crc to continue over several buffers
+inline uint16_t logCrc16(const void *data, size_t length, uint16_t crc = 0xffff) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    while (length--) {
+        crc ^= (uint16_t) *bytes++ << 8;
+        for (int bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+inline uint16_t logBlockCrc(uint8_t count, const void *payload, size_t length,
+    uint16_t seed = 0xffff) {
+    return logCrc16(payload, length, logCrc16(&count, 1, seed));
+}
+
+inline uint16_t logSlotSeed(uint32_t created, uint32_t slot) {
+    return logCrc16(&slot, sizeof(slot), logCrc16(&created, sizeof(created)));
+}
+
+#endif // LOGRECORD_HPP
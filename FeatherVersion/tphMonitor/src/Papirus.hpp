@@ -12,11 +12,16 @@
 #define FEATHER 1
 #define EPD_ENABLE_EXTRA_SRAM 1
 #define SCREEN_SIZE 200
+#define EPD_GFX_ROTATION 2 // upside down, fixed so EPD_GFX can specialise for it
+#define EPD_GFX_BACKGROUND 1 // keep a copy of the static layout (2400 bytes)
+#define EPD_GFX_FLASH_IMAGE 0 // the image on the panel in EPD_FLASH, not SRAM
+#define EPD_GFX_FLASH_FRAMES 16 // compressed, in a ring of sectors 0 to 15
 
 #include <Arduino.h>
 #include <inttypes.h>
 #include <ctype.h>
 #include <EPD_FLASH.h>
+#include <EPD_FRAMES.h>
 #include <EPD_V231_G2.h>
 #include <EPD_PANELS.h>
 #include <EPD_PINOUT.h> // requires modified version for Adafruit Feather M0 Adalogger
@@ -31,6 +36,7 @@
 #include <EPD_DEFINES.h>
 
 #include <DEBUG.h>
+#include "Timing.hpp"
 
 class Papirus {
 public:
@@ -40,21 +46,46 @@ public:
     void rmText(int x, int y, char *text, int fontSize = Papirus::SMALL);
     void addVertScale(int x, float min, float max, float major, float minor,
         float value, float lowVal, float highVal);
-    void partialUpdate();
+    // addVertScale() in two parts: the axis, which never changes, and the bar
+    // and values
+    void addVertAxis(int x, float min, float max, float major, float minor);
+    void addVertBar(int x, float min, float max, float minor,
+        float value, float lowVal, float highVal);
+    void addSparkline(int x, int y, int w, int h, const int32_t *values,
+        uint16_t count, int32_t minSpan = 1, int style = Papirus::LINE);
+    bool partialUpdate(int temperature); // false if nothing needed refreshing
     void fullUpdate(int temperature);
     void clear(int temperature);
 
+    // draw the static layout once and saveBackground(), then start every
+    // frame with restoreBackground(), or put back only the rectangles that
+    // are about to be redrawn, and draw only what changes
+    void saveBackground() { epd_gfx.saveBackground(); }
+    void restoreBackground();
+    void restoreBackground(int x, int y, int width, int height);
+
+    // the add*() functions say that they drew; after drawing straight with
+    // epd_gfx call this, or partialUpdate() may skip the update.  Which lines
+    // are refreshed is up to EPD_GFX, from the lines it saw change
+    void markDrawn() { drawn = true; }
+
+    // val as "%3d.%03u", sizeof("-XXX.XXX") for the full width
+    static void valToString(float val, char *valStr, size_t size);
+
     enum { SMALL, MEDIUM, LARGE };
+    enum { LINE, BARS }; // addSparkline() styles
 
     static EPD_GFX epd_gfx;
 
 private:
     static EPD_Class EPD;
+    bool drawn; // anything drawn since the last update
     // static const GFXfont *smallFont;
     // static const GFXfont *bigFont;
 
     void setupEPD(int temperature);
-    char *valToString(float val);
+    void printUpdateStats();
+    void recordUpdateTiming();
 };
 
 EPD_Class Papirus::EPD(EPD_SIZE, Pin_PANEL_ON, Pin_BORDER, Pin_DISCHARGE, Pin_RESET,
@@ -62,6 +93,7 @@ EPD_Class Papirus::EPD(EPD_SIZE, Pin_PANEL_ON, Pin_BORDER, Pin_DISCHARGE, Pin_RE
 EPD_GFX Papirus::epd_gfx(Papirus::EPD);
 
 Papirus::Papirus(int temperature) {
+    drawn = false;
     setupEPD(temperature);
 }
 
@@ -98,8 +130,8 @@ void Papirus::setupEPD(int temperature) {
     DEBUGPRINT(")...");
     epd_gfx.begin(temperature);
     DEBUGPRINTLN(" Done!");
-    DEBUGPRINT("calling epd_gfx.setRotation(2)...");
-    epd_gfx.setRotation(2);
+    DEBUGPRINT("calling epd_gfx.setRotation(" MAKE_STRING(EPD_GFX_ROTATION) ")...");
+    epd_gfx.setRotation(EPD_GFX_ROTATION);
     DEBUGPRINTLN(" Done!");
 
     #ifdef DEBUG
@@ -156,6 +188,7 @@ void Papirus::addBorder(int x, int y, int w, int h, int bw) {
     for (int i = 0; i < bw; i++) {
     	epd_gfx.drawRect(x + i, y + i, w - i, h - i, EPD_GFX::BLACK);
     }
+    markDrawn();
 }
 
 void Papirus::addText(int x, int y, const char *text, int fontSize) {
@@ -169,12 +202,9 @@ void Papirus::addText(int x, int y, const char *text, int fontSize) {
     // DEBUGPRINTLN(text);
     // DEBUGPRINTLN(fontSize);
 
-    epd_gfx.setFont();
-    epd_gfx.setCursor(x, y);
-    epd_gfx.setTextColor(EPD_GFX::BLACK, EPD_GFX::WHITE);
-    epd_gfx.setTextSize(fontSize);
-    epd_gfx.setTextWrap(false);
-    epd_gfx.print(text);
+    // the classic font, a cached glyph row at a time
+    epd_gfx.blitText(x, y, text, fontSize);
+    markDrawn();
 }
 
 void Papirus::rmText(int x, int y, char *text, int fontSize) {
@@ -196,15 +226,16 @@ void Papirus::rmText(int x, int y, char *text, int fontSize) {
 
 void Papirus::addVertScale(const int x, float min, float max, float major, float minor,
     float value, float lowVal, float highVal) {
-    // DEBUGPRINTLN("Papirus::addVertScale(int x, float min, float max, float major, float minor, float value, float lowVale, float highVal)");
-    // DEBUGPRINTLN(x);
-    // DEBUGPRINTLN(min);
-    // DEBUGPRINTLN(max);
-    // DEBUGPRINTLN(major);
-    // DEBUGPRINTLN(minor);
-    // DEBUGPRINTLN(value);
-    // DEBUGPRINTLN(lowVal);
-    // DEBUGPRINTLN(highVal);
+    addVertAxis(x, min, max, major, minor);
+    addVertBar(x, min, max, minor, value, lowVal, highVal);
+}
+
+// vertical scales share the space between the titles and the bottom edge
+#define VERTSCALE_BOTTOM (EPD_PIXEL_HEIGHT - 5) // 5 px from bottom
+#define VERTSCALE_TOP 25 // Two lines of text at top
+
+void Papirus::addVertAxis(const int x, float min, float max, float major, float minor) {
+    // DEBUGPRINTLN("Papirus::addVertAxis(int x, float min, float max, float major, float minor)");
 
     if (min > max) {
         DEBUGPRINTLN("min > max");
@@ -215,10 +246,8 @@ void Papirus::addVertScale(const int x, float min, float max, float major, float
         return;
     }
 
-    const int bottom = EPD_PIXEL_HEIGHT - 5; // 5 px from bottom
-    const int top = 25; // Two lines of text at top
-    const int heightPx = bottom - top;
-    const int barWidth = 4;
+    const int bottom = VERTSCALE_BOTTOM;
+    const int heightPx = bottom - VERTSCALE_TOP;
     const float pxScale = heightPx / (max - minor);
     const int majorPx = major * pxScale;
     const int minorPx = minor * pxScale;
@@ -228,16 +257,8 @@ void Papirus::addVertScale(const int x, float min, float max, float major, float
         return;
     }
 
-    if (value > max) value = max;
-    else if (value < min) value = min;
-
-    int barHeight = (value - min) * pxScale;
-    // DEBUGPRINT("barHeight = ");
-    // DEBUGPRINTLN(barHeight);
-
-    epd_gfx.fillRect(x + 1, bottom - heightPx, barWidth, heightPx, EPD_GFX::WHITE); // empty the thermometer
-    epd_gfx.fillRect(x + 1, bottom - barHeight, barWidth, barHeight, EPD_GFX::BLACK); // fill the thermometer
     epd_gfx.drawLine(x, bottom, x, bottom - heightPx, EPD_GFX::BLACK);
+    markDrawn();
 
     for (int tick = 0; tick <= heightPx; tick += 1) {
         if (tick % minorPx == 0) {
@@ -247,40 +268,151 @@ void Papirus::addVertScale(const int x, float min, float max, float major, float
                 epd_gfx.drawLine(x - 2, bottom - tick, x, bottom - tick, EPD_GFX::BLACK);
         }
     }
+}
+
+void Papirus::addVertBar(const int x, float min, float max, float minor,
+    float value, float lowVal, float highVal) {
+    // DEBUGPRINTLN("Papirus::addVertBar(int x, float min, float max, float minor, float value, float lowVal, float highVal)");
+
+    if (min > max) return; // addVertAxis() says why
+
+    const int bottom = VERTSCALE_BOTTOM;
+    const int top = VERTSCALE_TOP;
+    const int heightPx = bottom - top;
+    const int barWidth = 4;
+    const float pxScale = heightPx / (max - minor);
+
+    if (value > max) value = max;
+    else if (value < min) value = min;
 
-    char *lowStr = valToString(lowVal);
-    char *currentStr = valToString(value);
-    char *highStr = valToString(highVal);
+    int barHeight = (value - min) * pxScale;
+    // DEBUGPRINT("barHeight = ");
+    // DEBUGPRINTLN(barHeight);
 
-    if (lowVal < value) addText(x - 50, bottom - 7, lowStr, 1);
-    addText(x - 50, (top + bottom) / 2, currentStr, 1);
-    if (highVal > value) addText(x - 50, top + 7, highStr, 1);
+    epd_gfx.fillRect(x + 1, bottom - heightPx, barWidth, heightPx, EPD_GFX::WHITE); // empty the thermometer
+    epd_gfx.fillRect(x + 1, bottom - barHeight, barWidth, barHeight, EPD_GFX::BLACK); // fill the thermometer
+    markDrawn();
 
-    delete[] lowStr;
-    delete[] currentStr;
-    delete[] highStr;
+    char valStr[sizeof("-XXX.XXX")];
+    if (lowVal < value) {
+        valToString(lowVal, valStr, sizeof(valStr));
+        addText(x - 50, bottom - 7, valStr, 1);
+    }
+    valToString(value, valStr, sizeof(valStr));
+    addText(x - 50, (top + bottom) / 2, valStr, 1);
+    if (highVal > value) {
+        valToString(highVal, valStr, sizeof(valStr));
+        addText(x - 50, top + 7, valStr, 1);
+    }
+}
+
+// plot count values, oldest first, across a w x h box at x, y.  The vertical
+// scale is the values' own range, widened to at least minSpan so noise
+// doesn't fill the box.  LINE joins the points; BARS draws a bar for each.
+// Lines go straight into the frame buffer (EPD_GFX::drawLineDirect()), with
+// 16.16 fixed point steps so there's no division per sample.
+void Papirus::addSparkline(int x, int y, int w, int h, const int32_t *values,
+    uint16_t count, int32_t minSpan, int style) {
+    epd_gfx.fillRect(x, y, w, h, EPD_GFX::WHITE);
+    markDrawn();
+    if (! count || w < 1 || h < 1) return;
+
+    int32_t low = values[0], high = values[0];
+    for (uint16_t i = 1; i < count; i++) {
+        if (values[i] < low) low = values[i];
+        if (values[i] > high) high = values[i];
+    }
+    if (minSpan < 1) minSpan = 1;
+    if (high - low < minSpan) {
+        low -= (minSpan - (high - low)) / 2;
+        high = low + minSpan;
+    }
+
+    const int bottom = y + h - 1;
+    const int32_t yScale = ((int32_t) (h - 1) << 16) / (high - low);
+    const int32_t xStep = count > 1 ? ((int32_t) (w - 1) << 16) / (count - 1) : 0;
+    int32_t xFixed = count > 1 ? 0 : (int32_t) (w - 1) << 16; // a lone value goes at the right
+    int16_t lastX = 0, lastY = 0;
+    for (uint16_t i = 0; i < count; i++, xFixed += xStep) {
+        int16_t px = x + (xFixed >> 16);
+        int16_t py = bottom - (((values[i] - low) * yScale) >> 16);
+        if (style == BARS) epd_gfx.drawLineDirect(px, bottom, px, py, EPD_GFX::BLACK);
+        else if (i) epd_gfx.drawLineDirect(lastX, lastY, px, py, EPD_GFX::BLACK);
+        else epd_gfx.drawLineDirect(px, py, px, py, EPD_GFX::BLACK);
+        lastX = px;
+        lastY = py;
+    }
 }
 
-char *Papirus::valToString(float val) {
-    // DEBUGPRINTLN("Papirus::valToString(float val)");
+void Papirus::valToString(float val, char *valStr, size_t size) {
+    // DEBUGPRINTLN("Papirus::valToString(float val, char *valStr, size_t size)");
     // DEBUGPRINTLN(val);
 
-    int strSize = sizeof("-XXX.XXX");
-    char *valStr = new char[strSize];
     int valWhole = (int) val;
     unsigned int valFrac = (int)(val * 1000.) - valWhole * 1000;
-    snprintf(valStr, strSize, "%3d.%03u", valWhole, valFrac);
-    return valStr;
+    snprintf(valStr, size, "%3d.%03u", valWhole, valFrac);
 }
 
-void Papirus::partialUpdate() {
+bool Papirus::partialUpdate(int temperature) {
     // DEBUGPRINTLN("Papirus::partialUpdate()");
+
+    // nothing drawn since the last update, so nothing to compare
+    if (! drawn) return false;
+    drawn = false;
+
+    // only the lines that changed since the last update are driven
+    bool updated = epd_gfx.displayPartial(temperature);
+
+    if (updated) recordUpdateTiming();
+    printUpdateStats();
+    return updated;
 }
 
 void Papirus::fullUpdate(int temperature) {
     // DEBUGPRINTLN("Papirus::fullUpdate()");
 
     epd_gfx.display(temperature);
+    drawn = false;
+
+    recordUpdateTiming();
+    printUpdateStats();
+}
+
+void Papirus::printUpdateStats() {
+    #ifdef DEBUG
+    Serial.print("EPD SPI begin/end: ");
+    Serial.print(EPD.spi_begin_count());
+    Serial.print("/");
+    Serial.println(EPD.spi_end_count());
+    Serial.print("EPD repeats (overshoot ms):");
+    for (int stage = EPD_compensate; stage <= EPD_normal; stage++) {
+        Serial.print(" ");
+        Serial.print(EPD.repeats((EPD_stage) stage));
+        Serial.print(" (");
+        Serial.print(EPD.overshoot_ms((EPD_stage) stage));
+        Serial.print(")");
+    }
+    Serial.println();
+    #endif // DEBUG
+}
+
+void Papirus::recordUpdateTiming() {
+    TIMING_RECORD(EPD_BEGIN, EPD.begin_us());
+    TIMING_RECORD(EPD_COMPENSATE, EPD.stage_us(EPD_compensate));
+    TIMING_RECORD(EPD_WHITE, EPD.stage_us(EPD_white));
+    TIMING_RECORD(EPD_INVERSE, EPD.stage_us(EPD_inverse));
+    TIMING_RECORD(EPD_NORMAL, EPD.stage_us(EPD_normal));
+    TIMING_RECORD(EPD_END, EPD.end_us());
+}
+
+void Papirus::restoreBackground() {
+    epd_gfx.restoreBackground();
+    markDrawn();
+}
+
+void Papirus::restoreBackground(int x, int y, int w, int h) {
+    epd_gfx.restoreBackground(x, y, w, h);
+    markDrawn();
 }
 
 void Papirus::clear(int temperature) {
@@ -0,0 +1,223 @@
+// Scheduler.hpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor
+// Sleep between data points: program the PCF8523 to pull its INT line low at
+// the next interval boundary, put the SAMD21 into standby, and wake on that
+// interrupt.  Keeps how long each wake cycle spent awake and asleep.
+// Requires the Adalogger FeatherWing's INT pad wired to RTCINTPIN.
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#define RTCINTPIN A1 // PCF8523 INT (open drain, active low)
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "Sensors.hpp"
+#include <DEBUG.h>
+#ifdef HOST_SIM
+#include <HostSim.h>
+#endif
+
+// PCF8523 registers and bits
+#define PCF8523_ADDRESS 0x68
+#define PCF8523_CONTROL_1 0x00
+#define PCF8523_CONTROL_1_AIE 0x02 // alarm interrupt enable
+#define PCF8523_CONTROL_2 0x01
+#define PCF8523_CONTROL_2_CTAF 0x40 // countdown timer A flag
+#define PCF8523_CONTROL_2_AF 0x08 // alarm flag
+#define PCF8523_CONTROL_2_CTAIE 0x02 // countdown timer A interrupt enable
+#define PCF8523_MINUTE_ALARM 0x0A // then hour, day and weekday alarms
+#define PCF8523_ALARM_DISABLE 0x80
+#define PCF8523_TMR_CLKOUT_CTRL 0x0F
+#define PCF8523_TMR_CLKOUT_OFF 0x38 // COF = 111, INT pin is not a clock output
+#define PCF8523_TMR_A_COUNTDOWN 0x02 // TAC = 01
+#define PCF8523_TMR_A_FREQ_CTRL 0x10
+#define PCF8523_TMR_A_1HZ 0x02
+#define PCF8523_TMR_A_1_60HZ 0x03
+#define PCF8523_TMR_A_REG 0x11
+
+class Scheduler {
+public:
+    Scheduler(Sensors *sensors, uint16_t interval);
+
+    // sleep until the next interval boundary (counted from 2000-01-01
+    // 00:00:00), and return it
+    DateTime sleep();
+
+    // the last wake cycle: from one wake-up to the next sleep(), and the
+    // sleep that followed it
+    uint32_t awakeMs() const { return awakeMillis; }
+    uint32_t asleepMs() const { return asleepMillis; }
+
+private:
+    Sensors *sensors;
+    uint16_t interval;
+    uint32_t wokeAtMicros; // micros() when the last sleep() returned
+    long wokeAtSeconds; // boundary it returned at, 0 before the first
+    uint32_t awakeMillis;
+    uint32_t asleepMillis;
+    static volatile bool woken;
+
+    void armAlarm(const DateTime &when, bool matchHour);
+    void armTimer(uint8_t frequency, uint8_t count);
+    void disarm();
+    void standby();
+    static void wake();
+    static void writeRegister(uint8_t reg, uint8_t value);
+    static uint8_t readRegister(uint8_t reg);
+    static uint8_t bcd(uint8_t value) { return value / 10 * 16 + value % 10; }
+};
+
+volatile bool Scheduler::woken = false;
+
+Scheduler::Scheduler(Sensors *sensors, uint16_t interval) {
+    this->sensors = sensors;
+    this->interval = interval;
+    wokeAtMicros = 0; // setup() is the first cycle, awake from power on
+    wokeAtSeconds = 0;
+    awakeMillis = 0;
+    asleepMillis = 0;
+
+    disarm();
+    pinMode(RTCINTPIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(RTCINTPIN), Scheduler::wake, FALLING);
+
+    #if defined(ARDUINO_ARCH_SAMD) && ! defined(HOST_SIM)
+    // clock the EIC from the ultra low power 32 kHz oscillator, through a
+    // generator that keeps running in standby, so the pin can wake the chip
+    GCLK->CLKCTRL.reg = (uint16_t) (GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK6 | GCLK_CLKCTRL_ID(GCM_EIC));
+    while (GCLK->STATUS.bit.SYNCBUSY) ;
+    GCLK->GENCTRL.reg = (GCLK_GENCTRL_GENEN | GCLK_GENCTRL_SRC_OSCULP32K | GCLK_GENCTRL_ID(6) | GCLK_GENCTRL_RUNSTDBY);
+    while (GCLK->STATUS.bit.SYNCBUSY) ;
+    EIC->WAKEUP.reg |= (1 << g_APinDescription[RTCINTPIN].ulExtInt);
+    // errata: keep the flash powered in sleep
+    NVMCTRL->CTRLB.bit.SLEEPPRM = NVMCTRL_CTRLB_SLEEPPRM_DISABLED_Val;
+    #endif
+}
+
+DateTime Scheduler::sleep() {
+    uint32_t awake = micros() - wokeAtMicros;
+
+    DateTime now = sensors->getDateTime();
+    long next = (now.secondstime() / interval + 1) * interval;
+    long sleptFrom = now.secondstime();
+
+    // a timer can expire up to one tick early, so check and go round again
+    while (now.secondstime() < next) {
+        long remaining = next - now.secondstime();
+        if (next % 60 == 0 && remaining <= 86400L) {
+            // on a whole minute: the alarm fires exactly at hh:mm:00
+            armAlarm(DateTime(now + (TimeSpan) remaining), remaining > 3600);
+        }
+        else if (remaining <= 255) {
+            armTimer(PCF8523_TMR_A_1HZ, remaining);
+        }
+        else {
+            armTimer(PCF8523_TMR_A_1_60HZ, remaining / 60 > 255 ? 255 : remaining / 60);
+        }
+        standby();
+        disarm();
+        now = sensors->getDateTime();
+    }
+
+    wokeAtMicros = micros();
+    awakeMillis = awake / 1000;
+    // millis() stops in standby, so count in RTC seconds: a cycle runs
+    // boundary to boundary; the first one, from setup(), to the second
+    if (wokeAtSeconds) {
+        uint32_t cycle = (next - wokeAtSeconds) * 1000;
+        asleepMillis = cycle > awakeMillis ? cycle - awakeMillis : 0;
+    }
+    else {
+        asleepMillis = (next - sleptFrom) * 1000;
+    }
+    wokeAtSeconds = next;
+
+    DEBUGPRINT("Awake ");
+    DEBUGPRINT(awakeMillis);
+    DEBUGPRINT(" ms, asleep ");
+    DEBUGPRINT(asleepMillis);
+    DEBUGPRINTLN(" ms");
+    return now;
+}
+
+void Scheduler::armAlarm(const DateTime &when, bool matchHour) {
+    Wire.beginTransmission(PCF8523_ADDRESS);
+    Wire.write(PCF8523_MINUTE_ALARM);
+    Wire.write(bcd(when.minute()));
+    Wire.write(matchHour ? bcd(when.hour()) : PCF8523_ALARM_DISABLE);
+    Wire.write(PCF8523_ALARM_DISABLE); // day
+    Wire.write(PCF8523_ALARM_DISABLE); // weekday
+    Wire.endTransmission();
+
+    woken = false;
+    writeRegister(PCF8523_CONTROL_1, readRegister(PCF8523_CONTROL_1) | PCF8523_CONTROL_1_AIE);
+}
+
+void Scheduler::armTimer(uint8_t frequency, uint8_t count) {
+    Wire.beginTransmission(PCF8523_ADDRESS);
+    Wire.write(PCF8523_TMR_A_FREQ_CTRL);
+    Wire.write(frequency);
+    Wire.write(count);
+    Wire.endTransmission();
+
+    woken = false;
+    writeRegister(PCF8523_CONTROL_2, PCF8523_CONTROL_2_CTAIE);
+    writeRegister(PCF8523_TMR_CLKOUT_CTRL, PCF8523_TMR_CLKOUT_OFF | PCF8523_TMR_A_COUNTDOWN);
+}
+
+// stop the timer, disable the alarm and clear both flags, releasing INT
+void Scheduler::disarm() {
+    writeRegister(PCF8523_TMR_CLKOUT_CTRL, PCF8523_TMR_CLKOUT_OFF);
+    writeRegister(PCF8523_CONTROL_1, readRegister(PCF8523_CONTROL_1) & ~PCF8523_CONTROL_1_AIE);
+    writeRegister(PCF8523_CONTROL_2, 0);
+}
+
+void Scheduler::standby() {
+    #if defined(HOST_SIM)
+    while (! woken) sim::standby();
+    #elif defined(DEBUG)
+    // standby drops the USB serial port, so stay awake and wait for the pin
+    while (! woken) delay(10);
+    #else
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    // SysTick would only wake the chip again, as in ArduinoLowPower
+    SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+    while (! woken) {
+        // with interrupts masked, INT going low between the test and the WFI
+        // leaves the interrupt pending, which still ends the WFI -- it can't
+        // be taken first and leave the chip asleep with INT already low
+        __disable_irq();
+        if (! woken) {
+            __DSB();
+            __WFI();
+        }
+        __enable_irq();
+    }
+    SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+    #endif
+}
+
+void Scheduler::wake() {
+    woken = true;
+}
+
+void Scheduler::writeRegister(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(PCF8523_ADDRESS);
+    Wire.write(reg);
+    Wire.write(value);
+    Wire.endTransmission();
+}
+
+uint8_t Scheduler::readRegister(uint8_t reg) {
+    Wire.beginTransmission(PCF8523_ADDRESS);
+    Wire.write(reg);
+    Wire.endTransmission();
+    Wire.requestFrom(PCF8523_ADDRESS, 1);
+    return Wire.read();
+}
+
+#endif // SCHEDULER_HPP
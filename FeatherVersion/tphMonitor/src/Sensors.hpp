@@ -17,10 +17,40 @@
 
 #define VBATPIN A7
 
+// BMP280 registers.  It runs in forced mode: one conversion per acquire(),
+// asleep in between.
+#define BMP280_REG_CALIBRATION 0x88 // dig_T1 .. dig_P9, 12 little-endian words
+#define BMP280_REG_STATUS 0xF3
+#define BMP280_STATUS_MEASURING 0x08
+#define BMP280_REG_CTRL_MEAS 0xF4
+#define BMP280_REG_CONFIG 0xF5
+#define BMP280_REG_DATA 0xF7 // press_msb .. temp_xlsb
+#define BMP280_CTRL_MEAS_SLEEP 0x3C // temperature x1, pressure x16 (as Adafruit_BMP280::begin())
+#define BMP280_CTRL_MEAS_FORCED 0x3D
+#define BMP280_FORCED_MS 36 // typical conversion time at those settings, then poll
+
+// everything one data point needs, as read from the sensors; Sensors turns
+// it into units without going back to the bus
+struct SensorSnapshot {
+    uint16_t batteryAdc; // analogRead(VBATPIN)
+    int32_t bmp280AdcT; // 20 bit, uncompensated
+    int32_t bmp280AdcP;
+    int16_t si7021CentiC; // from the humidity conversion
+    uint16_t si7021HumidityBasisPoints;
+};
+
 class Sensors {
 public:
     Sensors(); // initialize all the sensors
     DateTime getDateTime(); // get the current Date/Time from the RTC
+
+    // one BMP280 conversion and one Si7021 humidity conversion (which also
+    // gives the temperature), the BMP280 converting while the Si7021 does
+    SensorSnapshot acquire();
+    uint16_t batteryMillivolts(const SensorSnapshot &snapshot);
+    int16_t bmp280CentiC(const SensorSnapshot &snapshot);
+    uint32_t bmp280Pressure_Pa(const SensorSnapshot &snapshot);
+
     float getTemperature_C(); // in Celcius
     float getTemperature_F(); // in Farenheit
     float getPressure_hPa();
@@ -31,7 +61,9 @@ public:
     int getHumidity_percent();
     float getBatteryVoltage();
 
-    float convert_hPa_inHg(float hPa);
+    static float convert_hPa_inHg(float hPa);
+    static float convert_m_ft(float m);
+    static float pressureAltitude_m(float hPa, float seaLevelPressure = 1013.25);
 
     // query specific sensors
     float getSi7021Temperature_C(); // more accurate than BMP280
@@ -44,11 +76,17 @@ public:
 
 private:
     void initSensors();
+    void startBMP280();
+    void readBMP280(SensorSnapshot &snapshot);
+    int32_t bmp280TFine(int32_t adcT);
+    void writeBMP280(uint8_t reg, uint8_t value);
     static bool initialized; // only need to initialize sensors once.
     static RTC_PCF8523 rtc; // keep track of the time
     static Adafruit_BMP280 bmp280; // temperature and pressure
     static SI7021 si7021; // temperature and humidity
     static float standardPressure; // international standard atmosphere sea level pressure, 1013.25 hPa, ~29.92 inHg
+    static uint16_t bmp280Calibration[12]; // dig_T1..T3, dig_P1..P9
+    static unsigned long bmp280Started; // millis() of the forced conversion
 };
 
 bool Sensors::initialized = false;
@@ -56,6 +94,8 @@ RTC_PCF8523 Sensors::rtc;// = new RTC_PCF8523();
 Adafruit_BMP280 Sensors::bmp280;// = new Adafruit_BMP280();
 SI7021 Sensors::si7021;// = new SI7021();
 float Sensors::standardPressure = 1013.25;
+uint16_t Sensors::bmp280Calibration[12];
+unsigned long Sensors::bmp280Started;
 
 // constructor also initializes all sensors
 Sensors::Sensors() {
@@ -73,6 +113,110 @@ void Sensors::initSensors() {
     while (! si7021.begin()) ;
 
     while (! bmp280.begin()) ;
+
+    // begin() leaves it converting continuously: no filter, and sleep until
+    // asked.  Keep the compensation words to convert raw readings here.
+    writeBMP280(BMP280_REG_CONFIG, 0);
+    writeBMP280(BMP280_REG_CTRL_MEAS, BMP280_CTRL_MEAS_SLEEP);
+    Wire.beginTransmission(BMP280_ADDRESS);
+    Wire.write(BMP280_REG_CALIBRATION);
+    Wire.endTransmission();
+    Wire.requestFrom(BMP280_ADDRESS, sizeof(bmp280Calibration));
+    for (int i = 0; i < 12; i++) {
+        bmp280Calibration[i] = Wire.read();
+        bmp280Calibration[i] |= Wire.read() << 8;
+    }
+}
+
+SensorSnapshot Sensors::acquire() {
+    SensorSnapshot snapshot;
+    startBMP280();
+    snapshot.batteryAdc = analogRead(VBATPIN);
+    si7021_env env = si7021.getHumidityAndTemperature();
+    snapshot.si7021CentiC = env.celsiusHundredths;
+    snapshot.si7021HumidityBasisPoints = env.humidityBasisPoints;
+    readBMP280(snapshot);
+    return snapshot;
+}
+
+uint16_t Sensors::batteryMillivolts(const SensorSnapshot &snapshot) {
+    // board divides by 2, 3.3V reference, 10 bit resolution
+    return (uint32_t) snapshot.batteryAdc * 2 * 3300 / 1024;
+}
+
+// compensation from the BMP280 datasheet (section 8.2), as Adafruit_BMP280
+int16_t Sensors::bmp280CentiC(const SensorSnapshot &snapshot) {
+    return (bmp280TFine(snapshot.bmp280AdcT) * 5 + 128) >> 8;
+}
+
+uint32_t Sensors::bmp280Pressure_Pa(const SensorSnapshot &snapshot) {
+    const uint16_t *cal = bmp280Calibration;
+    int64_t var1 = (int64_t) bmp280TFine(snapshot.bmp280AdcT) - 128000;
+    int64_t var2 = var1 * var1 * (int16_t) cal[8];
+    var2 = var2 + ((var1 * (int16_t) cal[7]) << 17);
+    var2 = var2 + ((int64_t) (int16_t) cal[6] << 35);
+    var1 = ((var1 * var1 * (int16_t) cal[5]) >> 8) + ((var1 * (int16_t) cal[4]) << 12);
+    var1 = ((((int64_t) 1 << 47) + var1) * cal[3]) >> 33;
+    if (var1 == 0) return 0; // avoid dividing by zero
+    int64_t p = 1048576 - snapshot.bmp280AdcP;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = ((int64_t) (int16_t) cal[11] * (p >> 13) * (p >> 13)) >> 25;
+    var2 = ((int64_t) (int16_t) cal[10] * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + ((int64_t) (int16_t) cal[9] << 4);
+    return (p + 128) >> 8; // Q24.8, rounded
+}
+
+float Sensors::pressureAltitude_m(float hPa, float seaLevelPressure) {
+    return 44330 * (1.0 - pow(hPa / seaLevelPressure, 0.1903));
+}
+
+float Sensors::convert_m_ft(float m) {
+    return m * 100. / (2.54 * 12);
+}
+
+void Sensors::startBMP280() {
+    writeBMP280(BMP280_REG_CTRL_MEAS, BMP280_CTRL_MEAS_FORCED);
+    bmp280Started = millis();
+}
+
+// wait out the conversion, then read pressure and temperature in one go
+void Sensors::readBMP280(SensorSnapshot &snapshot) {
+    unsigned long elapsed = millis() - bmp280Started;
+    if (elapsed < BMP280_FORCED_MS) delay(BMP280_FORCED_MS - elapsed);
+    uint8_t status;
+    do {
+        Wire.beginTransmission(BMP280_ADDRESS);
+        Wire.write(BMP280_REG_STATUS);
+        Wire.endTransmission();
+        Wire.requestFrom(BMP280_ADDRESS, 1);
+        status = Wire.read();
+        if (status & BMP280_STATUS_MEASURING) delay(1);
+    } while (status & BMP280_STATUS_MEASURING);
+
+    uint8_t data[6];
+    Wire.beginTransmission(BMP280_ADDRESS);
+    Wire.write(BMP280_REG_DATA);
+    Wire.endTransmission();
+    Wire.requestFrom(BMP280_ADDRESS, sizeof(data));
+    for (uint8_t i = 0; i < sizeof(data); i++) data[i] = Wire.read();
+    snapshot.bmp280AdcP = ((int32_t) data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
+    snapshot.bmp280AdcT = ((int32_t) data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
+}
+
+int32_t Sensors::bmp280TFine(int32_t adcT) {
+    int32_t t1 = bmp280Calibration[0];
+    int32_t t2 = (int16_t) bmp280Calibration[1];
+    int32_t t3 = (int16_t) bmp280Calibration[2];
+    int32_t var1 = (((adcT >> 3) - (t1 << 1)) * t2) >> 11;
+    int32_t var2 = (((((adcT >> 4) - t1) * ((adcT >> 4) - t1)) >> 12) * t3) >> 14;
+    return var1 + var2;
+}
+
+void Sensors::writeBMP280(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(BMP280_ADDRESS);
+    Wire.write(reg);
+    Wire.write(value);
+    Wire.endTransmission();
 }
 
 DateTime Sensors::getDateTime() {
@@ -100,7 +244,7 @@ float Sensors::getPressureAltitude_m() {
 }
 
 float Sensors::getPressureAltitude_ft() {
-    return getPressureAltitude_m() * 100. / (2.54 * 12);
+    return convert_m_ft(getPressureAltitude_m());
 }
 
 float Sensors::getAltitude_m(float seaLevelPressure) {
@@ -132,7 +276,10 @@ float Sensors::getSi7021Temperature_F() {
 }
 
 float Sensors::getBMP280Temperature_C() {
-    return bmp280.readTemperature();
+    SensorSnapshot snapshot;
+    startBMP280();
+    readBMP280(snapshot);
+    return bmp280CentiC(snapshot) / 100.;
 }
 
 int Sensors::getSi7021Humidity_percent() {
@@ -140,16 +287,18 @@ int Sensors::getSi7021Humidity_percent() {
 }
 
 float Sensors::getBMP280Pressure_hPa() {
-    return bmp280.readPressure() / 100.;
+    SensorSnapshot snapshot;
+    startBMP280();
+    readBMP280(snapshot);
+    return bmp280Pressure_Pa(snapshot) / 100.;
 }
 
 float Sensors::getBMP280PressureAltitude_m() {
-    return bmp280.readAltitude(standardPressure);
-
+    return pressureAltitude_m(getBMP280Pressure_hPa(), standardPressure);
 }
 
 float Sensors::getBMP280Altitude_m(float seaLevelPressure) {
-    return bmp280.readAltitude(seaLevelPressure);
+    return pressureAltitude_m(getBMP280Pressure_hPa(), seaLevelPressure);
 }
 
 #endif // SENSORS_HPP
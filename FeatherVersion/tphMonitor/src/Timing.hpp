@@ -0,0 +1,172 @@
+// Timing.hpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor
+// Time each phase of the wake cycle with micros() and keep the last
+// TIMING_RING samples of every phase in RAM.  Every TIMING_SUMMARY_CYCLES
+// cycles a min/mean/max line is written to Serial (in DEBUG) and to the log,
+// with the time the SD card was up today and the day before.  A binary log
+// only has the card up for its batches, so there the summary waits for the
+// next one and is written after its records (see setBatchComments()).
+// Only compiled in when TIMING is defined before the includes in main.cpp;
+// otherwise the TIMING_* macros expand to nothing.
+
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#ifdef TIMING
+
+#include <Arduino.h>
+#include <DEBUG.h>
+#include "LogFile.hpp"
+
+#define TIMING_START(PHASE) Timing::start(Timing::PHASE)
+#define TIMING_STOP(PHASE) Timing::stop(Timing::PHASE)
+#define TIMING_RECORD(PHASE, US) Timing::record(Timing::PHASE, US)
+#define TIMING_END_CYCLE(LOGFILE) Timing::endCycle(LOGFILE)
+
+#ifndef TIMING_RING
+#define TIMING_RING 12 // samples kept per phase (two hours at LOGINTERVAL)
+#endif
+#ifndef TIMING_SUMMARY_CYCLES
+#define TIMING_SUMMARY_CYCLES 6 // cycles between summary lines
+#endif
+
+class Timing {
+public:
+    enum Phase {
+        CYCLE, // whole wake cycle, from the top of the interval to sleep
+        ASLEEP, // standby before the cycle, to the ms (see Scheduler)
+        DATETIME, ACQUIRE, CONVERT, // DataPoint construction
+        RECORD, // recordDataPoint()
+        DRAW_HEADER, DRAW_SCALES, UPDATE, // displayDataPoint()
+        EPD_BEGIN, EPD_COMPENSATE, EPD_WHITE, EPD_INVERSE, EPD_NORMAL,
+        EPD_END, // inside UPDATE, as measured by EPD_Class
+        PHASES
+    };
+
+    static void start(Phase phase) {
+        started[phase] = micros();
+    }
+
+    static void stop(Phase phase) {
+        record(phase, micros() - started[phase]);
+    }
+
+    static void record(Phase phase, uint32_t us);
+    static void endCycle(LogFile *logFile);
+    static void summary(LogFile *logFile);
+
+private:
+    static void batchSummary(LogFile *logFile);
+    static void summaryLine(LogFile *logFile, const char *line);
+    static const char *const names[PHASES];
+    static uint32_t started[PHASES];
+    static uint32_t samples[PHASES][TIMING_RING];
+    static uint8_t next[PHASES]; // ring slot for the next sample
+    static uint8_t filled[PHASES]; // samples held, up to TIMING_RING
+    static uint16_t cycles;
+    static bool summaryDue; // for the next batch of a binary log
+};
+
+const char *const Timing::names[Timing::PHASES] = {
+    "cycle", "asleep",
+    "rtc", "acquire", "convert",
+    "record",
+    "header", "scales", "update",
+    "epdBegin", "compensate", "white", "inverse", "normal", "epdEnd"
+};
+uint32_t Timing::started[Timing::PHASES];
+uint32_t Timing::samples[Timing::PHASES][TIMING_RING];
+uint8_t Timing::next[Timing::PHASES];
+uint8_t Timing::filled[Timing::PHASES];
+uint16_t Timing::cycles = 0;
+bool Timing::summaryDue = false;
+
+void Timing::record(Phase phase, uint32_t us) {
+    samples[phase][next[phase]] = us;
+    if (++next[phase] == TIMING_RING) next[phase] = 0;
+    if (filled[phase] < TIMING_RING) filled[phase]++;
+}
+
+// call once per wake cycle, after the CYCLE phase has stopped
+void Timing::endCycle(LogFile *logFile) {
+    if (++cycles % TIMING_SUMMARY_CYCLES) return;
+    if (logFile->getFormat() == LogFile::TEXT) {
+        summary(logFile);
+        return;
+    }
+    // bringing the card up for the summary would defeat the batching it
+    // measures; one summary per batch, however many cycles it held
+    summaryDue = true;
+    logFile->setBatchComments(batchSummary);
+}
+
+// "# timing [us] min/mean/max: cycle 1/2/3 rtc 1/2/3 ... sdOn[ms/day] 4/5" --
+// the leading '#' lets anything reading the data lines skip it.  Lines are
+// kept short enough for a single binary comment block, continuing on a new
+// line as needed.
+void Timing::summary(LogFile *logFile) {
+    static const char prefix[] = "# timing [us] min/mean/max:";
+    char line[256];
+    char field[sizeof(" compensate 4294967295/4294967295/4294967295")];
+
+    strcpy(line, prefix);
+    for (int phase = 0; phase < PHASES; phase++) {
+        if (! filled[phase]) continue; // e.g. no EPD phases after a skipped update
+
+        uint32_t min = 0xffffffff, max = 0;
+        uint64_t sum = 0;
+        for (int i = 0; i < filled[phase]; i++) {
+            uint32_t us = samples[phase][i];
+            if (us < min) min = us;
+            if (us > max) max = us;
+            sum += us;
+        }
+
+        snprintf(field, sizeof(field), " %s %lu/%lu/%lu", names[phase],
+            (unsigned long) min, (unsigned long) (sum / filled[phase]), (unsigned long) max);
+        if (strlen(line) + strlen(field) >= sizeof(line)) {
+            summaryLine(logFile, line);
+            strcpy(line, prefix);
+        }
+        strcat(line, field);
+    }
+
+    // how long a binary log had the card up (see cardOnMillis()): today so
+    // far, and the whole day before
+    if (logFile->getFormat() == LogFile::BINARY) {
+        snprintf(field, sizeof(field), " sdOn[ms/day] %lu/%lu",
+            (unsigned long) logFile->cardOnMillis(0), (unsigned long) logFile->cardOnMillis(1));
+        if (strlen(line) + strlen(field) >= sizeof(line)) {
+            summaryLine(logFile, line);
+            strcpy(line, prefix);
+        }
+        strcat(line, field);
+    }
+
+    summaryLine(logFile, line);
+}
+
+// called by a binary log with the card up for a batch
+void Timing::batchSummary(LogFile *logFile) {
+    if (! summaryDue) return;
+    summaryDue = false;
+    summary(logFile);
+}
+
+void Timing::summaryLine(LogFile *logFile, const char *line) {
+    logFile->comment(line);
+    DEBUGPRINTLN(line);
+}
+
+#else
+
+#define TIMING_START(PHASE)
+#define TIMING_STOP(PHASE)
+#define TIMING_RECORD(PHASE, US)
+#define TIMING_END_CYCLE(LOGFILE)
+
+#endif // TIMING
+#endif // TIMING_HPP
@@ -26,11 +26,19 @@
 // #define DEBUG
 #include <DEBUG.h>
 
+// Uncomment to time each phase of the wake cycle and log a min/mean/max
+// summary line every few cycles (see Timing.hpp)
+// #define TIMING
+
 #include "Sensors.hpp"
 #include "LogFile.hpp"
 #include "DataPoint.hpp"
 #include "Papirus.hpp"
-// #include "Gauge.hpp"
+#include "Timing.hpp"
+#include "Scheduler.hpp"
+#include "History.hpp"
+#include "Gauge.hpp"
+#include "Journal.hpp"
 
 // For global constants, save RAM/cache by setting them at compile time
 #ifdef DEBUG
@@ -40,14 +48,41 @@
 #define LOGINTERVAL 600 // 10 minutes
 #endif // DEBUG
 
-// Global variables
-DateTime *nextPoint;
+// Log packed binary records (decode with tools/tphLogDecode), or
+// LogFile::TEXT for the pipe-delimited text log
+#define LOGFORMAT LogFile::BINARY
+
+// Binary records wait in RAM for a batch, so the SD card is only brought up
+// every LOGBATCH records (a sector of them, five hours at the normal
+// LOGINTERVAL), or every record once the battery is below LOWBATTERY_MV, so
+// nothing is left unwritten when it gives out
+#define LOGBATCH 31
+#define LOWBATTERY_MV 3500
+
+// Uncomment to draw the last day of pressure as a graph in place of the
+// pressure gauge
+// #define PRESSURE_TREND
+#define PRESSURE_TREND_SPAN 200 // Pa, the least the graph's height stands for
+
+// Partial updates leave some ghosting behind, so redraw the whole panel every
+// FULLUPDATECYCLES updates (once an hour at the normal LOGINTERVAL)
+#define FULLUPDATECYCLES 6
+
+// Global variables -- the objects themselves are statics in setup(), which
+// builds them in order; nothing is allocated on the heap once setup() is done
+Scheduler *scheduler;
 LogFile *logFile;
 Sensors *sensors;
 Papirus *papirus;
+History *history;
+Journal *journal;
+Gauge *tempGauge;
+Gauge *presGauge; // NULL with PRESSURE_TREND
+Gauge *humGauge;
 
 // Function Prototypes
 void recordDataPoint(const DataPoint &, LogFile *);
+void drawBackground();
 void displayDataPoint(const DataPoint &);
 void printDateTimeToFile(const DateTime &, ofstream &);
 
@@ -62,101 +97,108 @@ void setup() {
     DEBUGPRINTLN(LED_BUILTIN);
 
     // initialize all the sensors
-    sensors = new Sensors();
+    static Sensors theSensors;
+    sensors = &theSensors;
 
     // initialize the log file -- do this after initilizing the display, but before writing to the display to avoid weird bugs
-    logFile = LogFile::initSdLogFile(sensors, NULL, true);
+    logFile = LogFile::initSdLogFile(sensors, NULL, true, LOGFORMAT, LOGINTERVAL);
+    logFile->setMaxAge((uint32_t) LOGBATCH * LOGINTERVAL);
 
     // initialize the Papirus display
-    papirus = new Papirus(sensors->getTemperature_C());
-    papirus->addBorder();
+    static Papirus thePapirus(sensors->getTemperature_C());
+    papirus = &thePapirus;
+    drawBackground();
+
+    // the last day of data points, for the low/high marks, starting with
+    // those journaled before a reset
+    static History theHistory(LOGINTERVAL);
+    history = &theHistory;
+    static Journal theJournal;
+    journal = &theJournal;
+    journal->replay(history, HISTORY_SAMPLES);
 
     // record the first data point without delay
     DataPoint dp(sensors);
     recordDataPoint(dp, logFile);
+    history->add(dp);
+    journal->append(dp);
     displayDataPoint(dp);
 
-    // wait until just before the top of the next cycle to continue logging
-    // (allow a second to move into the loop() function)
-    // blink the LED to indicate waiting when in DEBUG mode
-    DEBUGPRINT("Waiting until the start of the next interval in ");
-    DEBUGPRINT(LOGINTERVAL - ((sensors->getDateTime().secondstime() + 1) % LOGINTERVAL));
-    DEBUGPRINTLN("s");
-    while ((sensors->getDateTime().secondstime() + 1) % LOGINTERVAL) {
-        #ifdef DEBUG
-        digitalWrite(LED_BUILTIN, HIGH);
-        delay(50);
-        digitalWrite(LED_BUILTIN, LOW);
-        delay(50);
-        #endif
-    }
+    // sleep between data points, woken by the RTC at the top of each cycle
+    static Scheduler theScheduler(sensors, LOGINTERVAL);
+    scheduler = &theScheduler;
 
-    nextPoint = new DateTime(sensors->getDateTime() + (TimeSpan) 1);
+    DEBUGHEAPSETTLED();
 }
 
 void loop() {
+    scheduler->sleep();
+    TIMING_RECORD(ASLEEP, scheduler->asleepMs() * 1000);
+
     DEBUGPRINTLN("loop()");
     // light the Red LED to indicate taking a measurement
     digitalWrite(LED_BUILTIN, HIGH);
 
-    while (sensors->getDateTime().secondstime() < nextPoint->secondstime())
-        delay(10); // catch the top of the cycle
-
+    TIMING_START(CYCLE);
     DataPoint dp(sensors);
+    TIMING_START(RECORD);
     recordDataPoint(dp, logFile);
+    TIMING_STOP(RECORD);
+    history->add(dp);
+    journal->append(dp);
     displayDataPoint(dp);
 
     // Measurement done, LED off
     digitalWrite(LED_BUILTIN, LOW);
-
-    DateTime *oldPoint = nextPoint;
-    nextPoint = new DateTime(*oldPoint + (TimeSpan) LOGINTERVAL);
-    delete oldPoint;
-    DEBUGPRINT("nextPoint = ");
-    DEBUGPRINTLN(nextPoint->secondstime());
-    DEBUGPRINT("Waiting ");
-    DEBUGPRINT(nextPoint->secondstime() - sensors->getDateTime().secondstime());
-    DEBUGPRINTLN("s until next loop");
-    delay((nextPoint->secondstime() - sensors->getDateTime().secondstime()) * 1000 - 100); // loop 0.1 second early
-    // #endif
+    TIMING_STOP(CYCLE);
+    TIMING_END_CYCLE(logFile);
 }
 
 void recordDataPoint(const DataPoint &dataPoint, LogFile *logfile) {
     // DEBUGPRINTLN("recordDataPoint()");
 
     // print data to Serial for debugging
-    DEBUGPRINT(dataPoint.dateTime.secondstime());
+    DEBUGPRINT(dataPoint.dateTime().secondstime());
     DEBUGPRINT("  ");
-    DEBUGPRINT(dataPoint.batteryVoltage);
+    DEBUGPRINT(dataPoint.batteryVoltage());
     DEBUGPRINT("V    (");
-    DEBUGPRINT(dataPoint.bmp280TemperatureC);
+    DEBUGPRINT(dataPoint.bmp280Temperature_C());
     DEBUGPRINT(" ± 1)°C    (");
-    DEBUGPRINT(dataPoint.si7021TemperatureC);
+    DEBUGPRINT(dataPoint.si7021Temperature_C());
     DEBUGPRINT(" ± 0.4)°C    (");
-    DEBUGPRINT(dataPoint.bmp280Pressure);
+    DEBUGPRINT(dataPoint.pressure_hPa());
     DEBUGPRINT(" ± 0.12)hPa    (");
-    DEBUGPRINT(dataPoint.bmp280PressureAltitudeM);
+    DEBUGPRINT(dataPoint.pressureAltitude_m());
     DEBUGPRINT(" ± 1)m   (");
-    DEBUGPRINT(dataPoint.si7021Humidity);
+    DEBUGPRINT(dataPoint.humidity_percent());
     DEBUGPRINTLN(" ± 3)% Rel Hum");
 
     // write data to SD Card, light up the LED during write
+    if (logfile->getFormat() == LogFile::BINARY) {
+        // on low battery, this writes out whatever is waiting with the record
+        logfile->setBatch(dataPoint.batteryMillivolts < LOWBATTERY_MV ? 1 : LOGBATCH);
+        digitalWrite(SDLED, HIGH);
+        logfile->append(dataPoint.record());
+        digitalWrite(SDLED, LOW);
+        return;
+    }
+
     logfile->resetSPI();
     if (logfile->stream.good()) {
         // DEBUGPRINTLN("recordDataPoint() -- good stream");
-        printDateTimeToFile(dataPoint.dateTime, logfile->stream);
+        printDateTimeToFile(dataPoint.dateTime(), logfile->stream);
         logfile->stream << " | ";
-        logfile->stream << dataPoint.batteryVoltage;
+        logfile->stream << dataPoint.batteryVoltage();
         logfile->stream << " | ";
-        logfile->stream << dataPoint.bmp280TemperatureC;
+        logfile->stream << dataPoint.bmp280Temperature_C();
         logfile->stream << " | ";
-        logfile->stream << dataPoint.si7021TemperatureC;
+        logfile->stream << dataPoint.si7021Temperature_C();
         logfile->stream << " | ";
-        logfile->stream << dataPoint.bmp280Pressure;
+        logfile->stream << dataPoint.pressure_hPa();
         logfile->stream << " | ";
-        logfile->stream << dataPoint.bmp280PressureAltitudeM;
+        logfile->stream << dataPoint.pressureAltitude_m();
         logfile->stream << " | ";
-        logfile->stream << dataPoint.si7021Humidity;
+        logfile->stream << dataPoint.humidityPermille / 10; // whole percent
         logfile->stream << endl;
 
         digitalWrite(SDLED, HIGH);
@@ -186,46 +228,90 @@ void printDateTimeToFile(const DateTime &dt, ofstream &stream) {
     stream << (int) dt.second();
 }
 
-void displayDataPoint(const DataPoint &dp) {
-    // DEBUGPRINTLN("displayDataPoint()");
+// the middle section, for PRESSURE_TREND
+#define PRESX 126
 
-    static int tempX = 60, presX = 126, humX = 192;
-    static float tempMin = 999999, presMin = 999999, humMin = 999999;
-    static float tempMax = -999999, presMax = -999999, humMax = -999999;
+// the parts of the display that never change, drawn once and kept by Papirus
+void drawBackground() {
+    papirus->addBorder();
+    papirus->epd_gfx.drawLine(0, 11, 200, 11, EPD_GFX::BLACK);
+
+    tempGauge = Gauge::GaugeMaker(papirus, Gauge::ONE, " Temp [F]", -10., 150., 10., 5.);
+    tempGauge->drawBackground();
+    #ifdef PRESSURE_TREND
+    papirus->addText(66 + 2, 14, "Pres [hPa]", 1);
+    presGauge = NULL;
+    #else
+    presGauge = Gauge::GaugeMaker(papirus, Gauge::TWO, "Pres [hPa]", 500., 1200., 200., 50.);
+    presGauge->drawBackground();
+    #endif
+    humGauge = Gauge::GaugeMaker(papirus, Gauge::THREE, "  Hum [%]", 0., 100., 10., 5.);
+    humGauge->drawBackground();
+
+    papirus->saveBackground();
+}
 
-    if (dp.si7021TemperatureF > tempMax) tempMax = dp.si7021TemperatureF;
-    if (dp.bmp280Pressure > presMax) presMax = dp.bmp280Pressure;
-    if (dp.si7021Humidity > humMax) humMax = dp.si7021Humidity;
+void displayDataPoint(const DataPoint &dp) {
+    // DEBUGPRINTLN("displayDataPoint()");
 
-    if (dp.si7021TemperatureF < tempMin) tempMin = dp.si7021TemperatureF;
-    if (dp.bmp280Pressure < presMin) presMin = dp.bmp280Pressure;
-    if (dp.si7021Humidity < humMin) humMin = dp.si7021Humidity;
+    // low/high marks over the last day
+    float tempMin = DataPoint::fahrenheit(history->minimum(History::TEMPERATURE, History::LONG));
+    float tempMax = DataPoint::fahrenheit(history->maximum(History::TEMPERATURE, History::LONG));
+    float presMin = DataPoint::hPa(history->minimum(History::PRESSURE, History::LONG));
+    float presMax = DataPoint::hPa(history->maximum(History::PRESSURE, History::LONG));
+    float humMin = DataPoint::percent(history->minimum(History::HUMIDITY, History::LONG));
+    float humMax = DataPoint::percent(history->maximum(History::HUMIDITY, History::LONG));
 
+    TIMING_START(DRAW_HEADER);
+    DateTime dateTime = dp.dateTime();
     char headerStr[sizeof("YYYY.MM.DD, HH:MM+SS L    +X.XXV")];
     snprintf(headerStr, sizeof(headerStr), "%04u.%02u.%02u, %02u:%02u+%02u L    +%1u.%02uV",
-        (unsigned int) dp.dateTime.year(),
-        (unsigned int) dp.dateTime.month(),
-        (unsigned int) dp.dateTime.day(),
-        (unsigned int) dp.dateTime.hour(),
-        (unsigned int) dp.dateTime.minute(),
-        (unsigned int) dp.dateTime.second(),
-        (unsigned int) dp.batteryVoltage,
-        (unsigned int) ((dp.batteryVoltage * 1000. - ((int) dp.batteryVoltage) * 1000) / 10.));
+        (unsigned int) dateTime.year() % 10000,
+        (unsigned int) dateTime.month() % 100,
+        (unsigned int) dateTime.day() % 100,
+        (unsigned int) dateTime.hour() % 100,
+        (unsigned int) dateTime.minute() % 100,
+        (unsigned int) dateTime.second() % 100,
+        (unsigned int) (dp.batteryMillivolts / 1000 % 10),
+        (unsigned int) (dp.batteryMillivolts % 1000 / 10));
 
     papirus->addText(5, 3, headerStr, 1);
-
-    papirus->epd_gfx.drawLine(0, 11, 200, 11, EPD_GFX::BLACK);
-
-    // papirus->addText(5, 5 + 14 * 3, "Temp [F]", 1);
-    papirus->addText(1 + 2, 14, " Temp [F]", 1);
-    // papirus->addText(66 + 4, 5 + 14 * 3, "Pres [hPa]", 1);
-    papirus->addText(66 + 2, 14, "Pres [hPa]", 1);
-    // papirus->addText(132 + 4, 5 + 14 * 3, "Rel Hum [%]", 1);
-    papirus->addText(132 + 2, 14, "  Hum [%]", 1);
-
-    papirus->addVertScale(tempX, -10., 150., 10., 5., dp.si7021TemperatureF, tempMin, tempMax);
-    papirus->addVertScale(presX, 500., 1200., 200., 50., dp.bmp280Pressure, presMin, presMax);
-    papirus->addVertScale(humX, 0., 100., 10., 5., dp.si7021Humidity, humMin, humMax);
-
-    papirus->fullUpdate(dp.si7021TemperatureC);
+    TIMING_STOP(DRAW_HEADER);
+
+    TIMING_START(DRAW_SCALES);
+    // each gauge redraws only what changed on it
+    tempGauge->setLowValue(tempMin);
+    tempGauge->setHighValue(tempMax);
+    tempGauge->setCurrentValue(dp.si7021Temperature_F());
+    tempGauge->draw();
+    #ifdef PRESSURE_TREND
+    // the current value over a graph of the history, oldest first
+    char presStr[sizeof("XXXX.XX")];
+    snprintf(presStr, sizeof(presStr), "%4u.%02u",
+        (unsigned int) (dp.pressurePa / 100), (unsigned int) (dp.pressurePa % 100));
+    papirus->addText(PRESX - 50, 25, presStr, 1);
+    int32_t trend[HISTORY_SAMPLES];
+    uint16_t samples = history->size();
+    for (uint16_t i = 0; i < samples; i++) trend[i] = (*history)[samples - 1 - i].pressurePa;
+    papirus->addSparkline(PRESX - 58, 35, 62, EPD_PIXEL_HEIGHT - 5 - 35, trend, samples,
+        PRESSURE_TREND_SPAN);
+    #else
+    presGauge->setLowValue(presMin);
+    presGauge->setHighValue(presMax);
+    presGauge->setCurrentValue(dp.pressure_hPa());
+    presGauge->draw();
+    #endif
+    humGauge->setLowValue(humMin);
+    humGauge->setHighValue(humMax);
+    humGauge->setCurrentValue(dp.humidity_percent());
+    humGauge->draw();
+    TIMING_STOP(DRAW_SCALES);
+
+    TIMING_START(UPDATE);
+    // between full updates, only refresh the lines that changed (the clock
+    // text, and whatever the gauges redrew)
+    static int updates = 0;
+    if (updates++ % FULLUPDATECYCLES == 0) papirus->fullUpdate(dp.si7021Temperature_C());
+    else papirus->partialUpdate(dp.si7021Temperature_C());
+    TIMING_STOP(UPDATE);
 }
@@ -0,0 +1,145 @@
+// tphLogDecode.cpp
+//
+// (c) Mark Busby <mark@BusbyCreations.com>
+//
+// Part of tphMonitor
+// Host-side decoder for the binary log (LogFile::BINARY, see
+// src/LogRecord.hpp).  Prints the same pipe-delimited text that the TEXT
+// format writes, so the existing analysis spreadsheets keep working.
+//
+// Build and run from the project directory:
+//     c++ -std=c++11 -O2 -o tphLogDecode tools/tphLogDecode.cpp -lm
+//     ./tphLogDecode 2017.01.18-1509_47.tph [more.tph ...] > log.txt
+//
+// Blocks that fail their CRC are reported on stderr and skipped; the exit
+// status is 1 if anything was skipped.  In a file of sector slots, the first
+// slot that doesn't start with a valid block is taken as the end of the log.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../src/LogRecord.hpp"
+
+// same as Sensors::standardPressure and Adafruit_BMP280::readAltitude()
+static float pressureAltitude_m(float hPa) {
+    return 44330 * (1.0 - pow(hPa / 1013.25, 0.1903));
+}
+
+static void printRecord(const LogRecord &r) {
+    time_t epoch = r.epoch;
+    struct tm dt;
+    gmtime_r(&epoch, &dt); // the RTC keeps local time, stored as if UTC
+
+    float hPa = r.pressurePa / 100.;
+    printf("%04d.%02d.%02d %02d:%02d:%02d | %.2f | %.2f | %.2f | %.2f | %.2f | %d\n",
+        dt.tm_year + 1900, dt.tm_mon + 1, dt.tm_mday, dt.tm_hour, dt.tm_min, dt.tm_sec,
+        r.batteryMillivolts / 1000., r.bmp280CentiC / 100., r.si7021CentiC / 100.,
+        hPa, pressureAltitude_m(hPa), r.humidityCentiPercent / 100);
+}
+
+enum BlockResult { BLOCK_OK, BLOCK_END, BLOCK_BAD };
+
+// decode one block at the current position.  BLOCK_END at the end of the
+// file or at a byte that isn't a block marker (erased or unwritten space).
+static BlockResult decodeBlock(FILE *in, const char *name, size_t room, uint16_t seed) {
+    long offset = ftell(in);
+    LogBlockHeader header;
+    if (room < sizeof(header) || fread(&header, sizeof(header), 1, in) != 1) return BLOCK_END;
+    if (header.marker != LOGBLOCK_RECORDS && header.marker != LOGBLOCK_COMMENT) return BLOCK_END;
+
+    uint8_t payload[255 * sizeof(LogRecord)];
+    size_t length = header.count;
+    if (header.marker == LOGBLOCK_RECORDS) length *= sizeof(LogRecord);
+    if (length > room - sizeof(header) || fread(payload, 1, length, in) != length) {
+        fprintf(stderr, "%s: block at offset %ld is truncated\n", name, offset);
+        return BLOCK_BAD;
+    }
+
+    if (logBlockCrc(header.count, payload, length, seed) != header.crc) {
+        fprintf(stderr, "%s: block at offset %ld fails its CRC\n", name, offset);
+        return BLOCK_BAD;
+    }
+
+    if (header.marker == LOGBLOCK_COMMENT) {
+        printf("%.*s\n", (int) length, (const char *) payload);
+    }
+    else {
+        for (int i = 0; i < header.count; i++) {
+            LogRecord record;
+            memcpy(&record, payload + i * sizeof(LogRecord), sizeof(record));
+            printRecord(record);
+        }
+    }
+    return BLOCK_OK;
+}
+
+// false if the file couldn't be read at all
+static bool decodeFile(const char *name, bool &bad) {
+    FILE *in = fopen(name, "rb");
+    if (in == NULL) {
+        perror(name);
+        return false;
+    }
+
+    LogFileHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1
+        || memcmp(header.magic, LOGFILE_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s: not a tphMonitor binary log\n", name);
+        fclose(in);
+        return false;
+    }
+    if (header.version != LOGFILE_VERSION || header.recordSize != sizeof(LogRecord)) {
+        fprintf(stderr, "%s: unsupported version %u (record size %u)\n",
+            name, header.version, header.recordSize);
+        fclose(in);
+        return false;
+    }
+
+    BlockResult result;
+    if (header.blockSize == 0) {
+        // packed blocks: nothing to resynchronise on after a bad one
+        while ((result = decodeBlock(in, name, SIZE_MAX, 0xffff)) == BLOCK_OK) ;
+        if (result == BLOCK_BAD) bad = true;
+    }
+    else {
+        // the header fills slot 0; the log ends at the first slot that
+        // doesn't start with a valid block (preallocated, never written)
+        for (uint32_t slot = 1; ; slot++) {
+            if (fseek(in, (long) slot * header.blockSize, SEEK_SET) != 0) break;
+            uint16_t seed = logSlotSeed(header.created, slot);
+            size_t used = 0;
+            int blocks = 0;
+            while (true) {
+                long start = ftell(in);
+                result = decodeBlock(in, name, header.blockSize - used, seed);
+                if (result != BLOCK_OK) break;
+                used += ftell(in) - start;
+                blocks++;
+            }
+            // a bad block after good ones in the slot was a torn write
+            if (result == BLOCK_BAD && blocks) bad = true;
+            if (! blocks) break;
+        }
+    }
+
+    fclose(in);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s LOGFILE.tph [...]\n", argv[0]);
+        return 2;
+    }
+
+    // same header line as LogFile writes for the TEXT format
+    printf("Date | Time | Battery Voltage [V] | BMP280 Temperature [°C, ±1] | Si7021 Temperature [°C, ±0.4] | BMP280 Pressure [hPa, ±0.12] | BMP280 Pressure Altitude [m, ±1] | Si7021 Relative Humidity [%%, ±3]\n");
+
+    bool bad = false;
+    for (int i = 1; i < argc; i++) {
+        if (! decodeFile(argv[i], bad)) bad = true;
+    }
+    return bad ? 1 : 0;
+}